@@ -15,31 +15,281 @@
 #include "motor.h"
 #include "encoder.h"
 #include "system_ctl.h"
+#include "speed_ctl.h"
+#include "trans_axis.h"
+#include "feed_ctl.h"
+#include "stall.h"
+#include "brake_predict.h"
+#include "ultrasonic.h"
+#include "gyroscope.h"
+#include "adc.h"
 #include <avr/io.h>
+#include <stdbool.h>
 #include <util/delay.h>
 
-//Motor Speeds
-#define ROTAT_DUTY_CYCLE 192 //75%
-#define TRANS_DUTY_CYCLE 204 //80%
+//Auger Speed
+#define ROTAT_TARGET_SPEED ROTAT_DRILL_SPEED //Encoder edges per 10ms window
+
+//Proportional RC channel bindings
+#define PROP_BIND_NONE  0 //Channel ignored
+#define PROP_BIND_SPEED 1 //Channel sets the auger speed
+#define PROP_BIND_FEED  2 //Channel sets the maximum feed rate
+
+//Pilot trim of the drilling parameters
+#define PROP_BINDING    PROP_BIND_SPEED
+#define ROTAT_MIN_SPEED (ROTAT_DRILL_SPEED / 2) //Auger speed at the bottom of the stick
+#define ROTAT_MAX_SPEED ROTAT_SPEED_MAX         //Auger speed at the top of the stick
 
 //Timing Delays
 #define MOTOR_DELAY 3500 //5 seconds
 #define BRAKE_DELAY 1000 //1 second
+#define DIG_WINDOWS 200  //2 seconds of encoder windows
+
+//Drilling depth below the soil surface in mm
+#define SAMPLE_DEPTH_MM 320
+
+//Peck cycle, distances in mm
+#define PECK_DEPTH_MM      80 //Depth drilled per peck
+#define PECK_BACK_OFF_MM   40 //Back off distance between pecks
+#define PECK_CLEARANCE_MM  5  //Gap left above the hole bottom on return
+#define PECK_DWELL_WINDOWS 50 //Encoder windows spent clearing soil
 
-//Translational Motor Revolutions
-#define TRANS_DIST 32000UL
+//Depth referencing from the ultrasonic ground distance
+#define TIP_OFFSET_MM       150  //Auger tip below the sensor faces at the start
+#define REF_MAX_GAP_MM      250  //Soil further below the tip is not believed
+#define SURFACE_APPROACH_MM 10   //Rapid approach stops this far above the soil
+#define REF_MIN_CONFIDENCE  75   //Ground filter confidence needed (%)
+#define REF_TIMEOUT_MS      2000 //Start position is the surface after this
+#define REF_POLL_MS         10
+
+//Peck cycle states
+#define PECK_DESCEND 0 //Feeding toward the next peck depth
+#define PECK_RETRACT 1 //Backing off to clear soil
+#define PECK_DWELL   2 //Auger clearing soil at the back off height
+#define PECK_RETURN  3 //Returning to just above the hole bottom
+#define PECK_DONE    4 //Final depth reached
 
 //Red LED location
 #define GREEN_LED 6
 #define RED_LED   5
 #define BLUE_LED  4
 
-int main()
+//Peck cycle configuration, encoder counts below the soil surface
+typedef struct {
+	int32_t depth;     //Final depth
+	int32_t peck;      //Depth drilled per peck
+	int32_t retract;   //Back off distance between pecks
+	int32_t clearance; //Gap left above the hole bottom on return
+	uint16_t dwell;    //Encoder windows spent clearing soil
+}peck_config;
+
+static const peck_config peck_cfg = {
+	TRANS_AXIS_MM(SAMPLE_DEPTH_MM), TRANS_AXIS_MM(PECK_DEPTH_MM),
+	TRANS_AXIS_MM(PECK_BACK_OFF_MM), TRANS_AXIS_MM(PECK_CLEARANCE_MM),
+	PECK_DWELL_WINDOWS
+};
+
+//Starting position of the carriage, above the soil surface at zero
+static int32_t home = 0;
+
+//Gyroscope present to give the air temperature
+static bool gyro_ok = false;
+
+//Peck cycle state
+static uint8_t peck_state = PECK_DONE;
+static int32_t peck_target = 0; //Depth of the peck in progress
+static int32_t peck_bottom = 0; //Deepest point drilled so far
+static uint16_t peck_windows = 0;
+static uint8_t peck_window = 0;
+
+//Feed toward a depth at the rate the auger load allows
+static void feed_to(int32_t target)
+{
+	init_feed_ctl(FEED_LOAD_DROOP, FEED_DROOP_TARGET);
+	set_feed_limits(FEED_MIN_VEL, get_jam_feed_limit());
+	trans_axis_move_to(target);
+}
+
+//Move at the full feed rate, never above the starting position
+static void rapid_to(int32_t target)
+{
+	if(target < home) target = home;
+	set_trans_axis_limits(TRANS_AXIS_MAX_VEL, TRANS_AXIS_MAX_ACC,
+	                      TRANS_AXIS_MAX_JERK);
+	trans_axis_move_to(target);
+}
+
+//Begin the peck cycle from the current position
+static void start_peck_cycle(void)
+{
+	peck_bottom = get_trans_axis_position();
+	peck_target = peck_bottom + peck_cfg.peck;
+	if(peck_target > peck_cfg.depth) peck_target = peck_cfg.depth;
+	peck_state = PECK_DESCEND;
+	feed_to(peck_target);
+}
+
+//Restart the peck in progress, e.g. after a jam has been cleared
+static void resume_peck_cycle(void)
+{
+	peck_state = PECK_DESCEND;
+	feed_to(peck_target);
+}
+
+//Advance the peck cycle, returns true once the final depth is reached
+static bool update_peck_cycle(void)
 {
-	uint16_t trans_enc_cnt = 0;
-	uint16_t rotat_enc_cnt = 0;
-	uint16_t ret_dist = 0;
+	if(peck_state == PECK_DESCEND) update_feed_ctl();
+	update_trans_axis();
+
+	switch(peck_state)
+	{
+		case PECK_DESCEND:
+			if(!trans_axis_done()) break;
+			peck_bottom = peck_target;
+			if(peck_bottom >= peck_cfg.depth)
+			{
+				peck_state = PECK_DONE;
+				break;
+			}
+			rapid_to(peck_bottom - peck_cfg.retract);
+			peck_state = PECK_RETRACT;
+			break;
+
+		case PECK_RETRACT:
+			if(!trans_axis_done()) break;
+			peck_windows = peck_cfg.dwell;
+			peck_window = get_encoder_window();
+			peck_state = PECK_DWELL;
+			break;
+
+		case PECK_DWELL:
+			if(peck_windows && (get_encoder_window() != peck_window))
+			{
+				peck_window = get_encoder_window();
+				peck_windows--;
+			}
+			if(peck_windows) break;
+			rapid_to(peck_bottom - peck_cfg.clearance);
+			peck_state = PECK_RETURN;
+			break;
+
+		case PECK_RETURN:
+			if(!trans_axis_done()) break;
+			peck_target = peck_bottom + peck_cfg.peck;
+			if(peck_target > peck_cfg.depth) peck_target = peck_cfg.depth;
+			peck_state = PECK_DESCEND;
+			feed_to(peck_target);
+			break;
+
+		default:
+			break;
+	}
+
+	return (peck_state == PECK_DONE);
+}
+
+//Set the speed of sound for ultrasonic ranging from the gyroscope die
+//temperature, the driver keeps its default if there is no gyroscope
+static void update_air_temp(void)
+{
+	int8_t temp;
+
+	if(gyro_ok && read_gyro_temp(&temp)) set_ultrasonic_temp(temp);
+}
+
+//Zero the translational axis at the soil surface from the ultrasonic
+//ground distance, with the carriage at its starting position. Returns
+//false until a sensor has a confident ground distance.
+static bool reference_depth(void)
+{
+	uint32_t sum = 0;
+	uint8_t n = 0;
+
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
+	{
+		uint16_t ground = get_ground_mm(id);
+
+		if((ground != ULTRASONIC_TIMEOUT) &&
+		   (get_ground_confidence(id) >= REF_MIN_CONFIDENCE))
+		{
+			sum += ground;
+			n++;
+		}
+	}
+	if(n == 0) return false;
+
+	//Air between the auger tip and the soil
+	int32_t gap = (int32_t)(sum / n) - TIP_OFFSET_MM;
+	if(gap < 0) gap = 0;
+
+	//The drill stands on the soil, so a longer range is something
+	//else, e.g. a hollow, and the start position is kept instead
+	if(gap > REF_MAX_GAP_MM) return false;
+
+	set_trans_axis_position(-TRANS_AXIS_MM(gap));
+
+	return true;
+}
+
+//Apply the proportional channel to the bound drilling parameter,
+//the defaults are kept while the channel has no signal
+static void update_pilot_trim(void)
+{
+#if PROP_BINDING == PROP_BIND_SPEED
+	uint16_t speed = ROTAT_TARGET_SPEED;
+
+	if(!sys_cntl_prop_lost())
+	{
+		speed = ROTAT_MIN_SPEED + (uint16_t)(((uint32_t)get_sys_cntl_prop() *
+		        (ROTAT_MAX_SPEED - ROTAT_MIN_SPEED)) / UINT8_MAX);
+	}
+	set_rotat_speed_target(speed);
+#elif PROP_BINDING == PROP_BIND_FEED
+	uint16_t limit = get_jam_feed_limit();
 
+	if(!sys_cntl_prop_lost())
+	{
+		uint16_t trim = FEED_MIN_VEL + (uint16_t)(((uint32_t)get_sys_cntl_prop() *
+		                (FEED_MAX_VEL - FEED_MIN_VEL)) / UINT8_MAX);
+		if(trim < limit) limit = trim;
+	}
+	set_feed_limits(FEED_MIN_VEL, limit);
+#endif
+}
+
+//Operator override, lost control signal or overcurrent trip
+static bool abort_requested(void)
+{
+	sys_event event = get_sys_cntl_event();
+
+	//Act on transitions only, OFF and ENABLE are ignored while running
+	return (event == SYS_EVENT_OVERRIDE) || (event == SYS_EVENT_UNKNOWN) ||
+	       get_motor_fault();
+}
+
+//Keep the auger under speed control for a number of encoder windows,
+//returns false if aborted
+static bool run_auger(uint16_t windows)
+{
+	uint8_t last = get_encoder_window();
+
+	while(windows)
+	{
+		if(abort_requested()) return false;
+		update_pilot_trim();
+
+		uint8_t window = get_encoder_window();
+		uint8_t ticks = window - last;
+		last = window;
+		windows = (ticks < windows) ? (windows - ticks) : 0;
+	}
+
+	return true;
+}
+
+int main()
+{
 	bool override = false;
 
 	//Configure LED output ports
@@ -48,7 +298,11 @@ int main()
 	//Initialize drivers
 	init_encoders();
 	init_motor_drivers();
+	init_adc(); //Motor current on PA7, clear of the LEDs
+	init_overcurrent_trip(); //Only with MOTOR_OVERCURRENT_TRIP
 	init_system_cntl();
+	init_ultrasonic_sensors();
+	gyro_ok = init_gyro(RANGE_245_DPS); //Air temperature for ranging
 	brake_rotational_motor();
 	brake_translational_motor();
 
@@ -57,61 +311,126 @@ int main()
 	clear_rotat_encoder_cnt();
 
 	start_encoders();
+	init_trans_axis();
 	
-	//Set motor speeds
-	set_rotational_motor_speed(ROTAT_DUTY_CYCLE);
-	set_translational_motor_speed(TRANS_DUTY_CYCLE);
+	//Set auger speed
+	init_rotat_speed_ctl();
+	set_rotat_speed_target(ROTAT_TARGET_SPEED);
+
+	//Fill the ground filters while waiting
+	update_air_temp();
+	start_ultrasonic_ranging();
 
-	//Poll for input signal
-	while(!get_sys_cntl_state());
+	//Wait for the operator to switch to ENABLE
+	while(get_sys_cntl_event() != SYS_EVENT_ENABLE);
 
 	PORTA |= (1 << BLUE_LED);
-	
-	while(trans_enc_cnt < TRANS_DIST)
+
+	//Depths are below the soil surface, or below the starting
+	//position if the ground cannot be seen
+	for(uint16_t ms = 0; !reference_depth() && (ms < REF_TIMEOUT_MS);
+	    ms += REF_POLL_MS)
+	{
+		if(abort_requested())
+		{
+			override = true;
+			goto MANUAL_OVERRIDE;
+		}
+		update_air_temp();
+		_delay_ms(REF_POLL_MS);
+	}
+	home = get_trans_axis_position();
+
+	//The soil hides the ground from here on
+	stop_ultrasonic_ranging();
+
+	//Rapid down to just above the soil instead of drilling air
+	rotational_motor_right();
+	rapid_to(-TRANS_AXIS_MM(SURFACE_APPROACH_MM));
+
+	while(!trans_axis_done())
 	{
-		trans_enc_cnt = get_trans_encoder_cnt();
+		//Manual override, signal loss or overcurrent trip
+		if(abort_requested())
+		{
+			override = true;
+			goto MANUAL_OVERRIDE;
+		}
+
+		update_pilot_trim();
+		update_trans_axis();
+	}
+
+	//Peck down to drilling depth, feed rate follows the auger load
+	init_jam_recovery(home); //Retracts stop at the starting position
+	start_peck_cycle();
 
-		//Manual override
-		if(get_sys_cntl_state())
+	while(1)
+	{
+		//Manual override, signal loss or overcurrent trip
+		if(abort_requested())
 		{
-			ret_dist = trans_enc_cnt;
 			override = true;
 			goto MANUAL_OVERRIDE;
 		}
 
-		//Test both motors in first direction
-		rotational_motor_right();
-		translational_motor_down();
-		
+		//Free a jammed auger, then retry the peck with a reduced feed rate
+		if(jam_recovery_active())
+		{
+			jam_state jam = update_jam_recovery();
+
+			if(jam == JAM_RESUME)
+			{
+				resume_peck_cycle();
+			}
+			else if(jam == JAM_FAILED)
+			{
+				override = true;
+				goto MANUAL_OVERRIDE;
+			}
+			continue;
+		}
+
+		update_pilot_trim();
+		if(update_peck_cycle()) break;
+
+		if(check_auger_stall()) start_jam_recovery();
 	}
+	reset_jam_recovery();
 
-	brake_translational_motor();
-	_delay_ms(2000);
 	//Dig additional soil
+	if(!run_auger(DIG_WINDOWS))
+	{
+		override = true;
+		goto MANUAL_OVERRIDE;
+	}
 	brake_rotational_motor();
 	PORTA |= (1 << GREEN_LED);
 	_delay_ms(1000);
 
-	clear_trans_encoder_cnt();
-	clear_rotat_encoder_cnt();
-	trans_enc_cnt = 0;
+	//Retract to the starting position at full speed
+	rotational_motor_left();
+	set_trans_axis_limits(TRANS_AXIS_MAX_VEL, TRANS_AXIS_MAX_ACC,
+	                      TRANS_AXIS_MAX_JERK);
+	trans_axis_move_to(home);
 
-	while(get_trans_encoder_cnt() < TRANS_DIST)
+	while(!trans_axis_done())
 	{
-		//Manual override
-		if(get_sys_cntl_state())
+		//Manual override, signal loss or overcurrent trip
+		if(abort_requested())
 		{
 			override = true;
 			goto MANUAL_OVERRIDE;
 		}
 	
-		//Test both motors in first direction
-		rotational_motor_left();
-		translational_motor_up();
+		update_trans_axis();
 	}
 
 	brake_rotational_motor();
-	brake_translational_motor();
+	stop_trans_axis();
+
+	//Keep the braking distances learned this cycle
+	save_brake_predictor();
 
 	//Blink LED when drilling completes
 	for(uint8_t i = 0; i < 3; i++)
@@ -130,21 +449,37 @@ MANUAL_OVERRIDE:
 	{ 
 		PORTA = ((PORTA & ~(1 << BLUE_LED)) | (1 << RED_LED));
 		brake_rotational_motor();
-		brake_translational_motor();
+		stop_trans_axis();
 
-		//Wait for second button press
+		//Only a new command may start the retract
+		clear_sys_cntl_events();
+
+		//Wait for the operator to switch back to ENABLE
+		bool enable_pending = false;
 		while(1)
 		{
-			if(get_sys_cntl_state())
+			//An ENABLE is held until the fault clears, any other
+			//command cancels it
+			sys_event event = get_sys_cntl_event();
+			if(event == SYS_EVENT_ENABLE) enable_pending = true;
+			else if(event != SYS_EVENT_NONE) enable_pending = false;
+
+			//Motors stay braked until an overcurrent fault clears
+			if(enable_pending && clear_motor_fault())
 			{
-				while(get_trans_encoder_cnt() < ret_dist)
+				//Retract to the starting position
+				rotational_motor_left();
+				set_trans_axis_limits(TRANS_AXIS_MAX_VEL, TRANS_AXIS_MAX_ACC,
+				                      TRANS_AXIS_MAX_JERK);
+				trans_axis_move_to(home);
+
+				while(!trans_axis_done())
 				{
-					rotational_motor_left();
-					translational_motor_up();
+					update_trans_axis();
 				}
 
-				brake_translational_motor();
 				brake_rotational_motor();
+				save_brake_predictor();
 				break;
 			}
 		}
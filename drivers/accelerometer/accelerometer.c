@@ -153,8 +153,8 @@ bool init_accel(void)
 	uint8_t ctrl_val = 0;
 	/*Set up the TWI hardware*/
 	init_i2c();
-	/*Set Data Rate at 10Hz and enable Z-Axis, Y-Axis, and X-Axis*/
-	uint8_t data = ((1 << ODR1) | (1 << Z_EN) | (1 << Y_EN) | (1 << X_EN));
+	/*Set Data Rate at 100Hz and enable Z-Axis, Y-Axis, and X-Axis*/
+	uint8_t data = ((1 << ODR2) | (1 << ODR0) | (1 << Z_EN) | (1 << Y_EN) | (1 << X_EN));
 	/*Write the control register and enable accelerometer*/
 	bool status = write_accel_reg((uint8_t)CTRL_REG1_A,data);
 	/*Read back control register to ensure proper configuration*/
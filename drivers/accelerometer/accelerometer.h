@@ -53,7 +53,7 @@ typedef struct {
  * DESCRIPTION:
  *  - Initializes the Adafruit LSM303 accelerometer. This function
  *    initializes I2C communication. It also sets the device data
- *    rate to 10Hz and enables x-axis, y-axis, and z-axis data.
+ *    rate to 100Hz and enables x-axis, y-axis, and z-axis data.
  *    The device address has been hard-coded into the implementation.
  *    This function must be called before attempting to read the
  *    the accelerometer data. If initialization is successful, the
@@ -0,0 +1,287 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Implementation of the interrupt driven ADC driver. See adc.h
+ *    for further details.
+ *
+ *    With a /128 prescaler the ADC clock is 62.5kHz and a free-
+ *    running conversion completes every 13 ADC clocks (~4.8kHz).
+ *    Channels are sampled round-robin, so with all three channels
+ *    each receives ~1.6k samples per second and, after 16x
+ *    oversampling, a new 12-bit result every ~10ms (one encoder
+ *    velocity window).
+ *
+ *    In free-running mode the next conversion starts as soon as
+ *    the current one completes, so a MUX change made in the ISR
+ *    only applies to the conversion after the one in progress.
+ *    The ISR therefore tracks the channel of the result being
+ *    read separately from the channel already being converted.
+ *    The first result after the ADC is started is discarded, as
+ *    the first conversion also initializes the analog circuitry.
+ *
+ **************************************************************/
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "adc.h"
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*ADMUX Register Bits*/
+#define REFS1 7
+#define REFS0 6
+#define MUX_MASK 0x1F
+
+/*ADCSRA Register Bits*/
+#define ADEN  7
+#define ADSC  6
+#define ADATE 5
+#define ADIF  4
+#define ADIE  3
+#define ADPS2 2
+#define ADPS1 1
+#define ADPS0 0
+
+/*ADCSRB Register Bits (ADTS = 0 selects free-running mode)*/
+#define ADTS_MASK 0x07
+
+/*Clear Register*/
+#define CLEAR 0x00
+
+/*Samples summed per decimated result (4^2 for two extra bits)*/
+#define ADC_OVERSAMPLE 16
+#define ADC_DECIMATE_SHIFT 2
+
+/*Ring index mask*/
+#define RING_MASK (ADC_RING_SIZE - 1)
+
+#if (ADC_RING_SIZE & RING_MASK) != 0
+#error "ADC_RING_SIZE must be a power of two"
+#endif
+
+/*Shift converting a ring sum to a mean*/
+#if ADC_RING_SIZE == 1
+#define RING_SHIFT 0
+#elif ADC_RING_SIZE == 2
+#define RING_SHIFT 1
+#elif ADC_RING_SIZE == 4
+#define RING_SHIFT 2
+#elif ADC_RING_SIZE == 8
+#define RING_SHIFT 3
+#elif ADC_RING_SIZE == 16
+#define RING_SHIFT 4
+#else
+#error "Unsupported ADC_RING_SIZE"
+#endif
+
+/********************************************
+ * 		          Structs                   *
+ ********************************************/
+/*Per-Channel Filter State*/
+typedef struct {
+	uint16_t acc;                  //Oversampling accumulator
+	uint8_t samples;               //Samples in the accumulator
+	uint8_t head;                  //Index of the newest result
+	uint8_t seq;                   //Results produced
+	uint16_t ring_sum;             //Sum of the ring contents
+	uint16_t ring[ADC_RING_SIZE];  //Decimated results
+}adc_filter;
+
+/********************************************
+ * 		      Global Variables              *
+ ********************************************/
+/*MUX value of each channel, only the first ADC_SAMPLED_CHANNELS
+  are converted*/
+static const uint8_t adc_mux[ADC_NUM_CHANNELS] = {
+	ROTAT_CURRENT_ADC,
+	TRANS_CURRENT_ADC,
+	BATTERY_ADC,
+};
+
+static volatile adc_filter filter[ADC_NUM_CHANNELS];
+
+/*Channel of the completed result and of the running conversion*/
+static volatile uint8_t result_ch = 0;
+static volatile uint8_t running_ch = 0;
+
+/*Discards the result of the first conversion*/
+static volatile bool first_conversion = true;
+
+/********************************************
+ * 	    Static Function Prototypes          *
+ ********************************************/
+static uint8_t next_channel(uint8_t ch);
+static void store_result(volatile adc_filter *f, uint16_t result);
+
+/*Channel following "ch" in the sampling sequence*/
+static uint8_t next_channel(uint8_t ch)
+{
+	return (ch + 1 < ADC_SAMPLED_CHANNELS) ? ch + 1 : 0;
+}
+
+/*Push a decimated result into a channel's ring*/
+static void store_result(volatile adc_filter *f, uint16_t result)
+{
+	uint8_t head = (f->head + 1) & RING_MASK;
+
+	f->ring_sum += result - f->ring[head];
+	f->ring[head] = result;
+	f->head = head;
+	f->seq++;
+}
+
+/********************************************
+ * 		  Interrupt Service Routines        *
+ ********************************************/
+ISR(ADC_vect)
+{
+	uint16_t sample = ADC;
+	uint8_t ch = result_ch;
+
+	/*Queue the channel after the one being converted*/
+	uint8_t queued = next_channel(running_ch);
+	ADMUX = (ADMUX & ~MUX_MASK) | adc_mux[queued];
+	result_ch = running_ch;
+	running_ch = queued;
+
+	if(first_conversion)
+	{
+		first_conversion = false;
+		return;
+	}
+
+	volatile adc_filter *f = &filter[ch];
+	f->acc += sample;
+	if(++f->samples == ADC_OVERSAMPLE)
+	{
+		store_result(f, f->acc >> ADC_DECIMATE_SHIFT);
+		f->acc = 0;
+		f->samples = 0;
+	}
+}
+
+/********************************************
+ * 		        API Functions               *
+ ********************************************/
+/*See adc.h for details*/
+void init_adc(void)
+{
+	uint8_t ch;
+
+	ADCSRA = CLEAR;
+
+	/*Disable the digital input buffers of the analog pins*/
+	for(ch = 0; ch < ADC_SAMPLED_CHANNELS; ch++)
+	{
+		DIDR0 |= (1 << adc_mux[ch]);
+	}
+
+	for(ch = 0; ch < ADC_NUM_CHANNELS; ch++)
+	{
+		volatile adc_filter *f = &filter[ch];
+		f->acc = 0;
+		f->samples = 0;
+		f->head = 0;
+		f->seq = 0;
+		f->ring_sum = 0;
+		for(uint8_t i = 0; i < ADC_RING_SIZE; i++)
+		{
+			f->ring[i] = 0;
+		}
+	}
+
+	/*First conversion uses channel 0, the second is queued in the ISR*/
+	result_ch = 0;
+	running_ch = 0;
+	first_conversion = true;
+
+	/*AVCC reference, right adjusted, first channel selected*/
+	ADMUX = (1 << REFS0) | adc_mux[0];
+
+	/*Free-running trigger source*/
+	ADCSRB &= ~ADTS_MASK;
+
+	/*Enable, auto trigger, interrupt, clk/128 and start*/
+	ADCSRA = (1 << ADEN) | (1 << ADATE) | (1 << ADIE) | (1 << ADIF) |
+	         (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+	ADCSRA |= (1 << ADSC);
+
+	sei();
+}
+
+/*See adc.h for details*/
+void stop_adc(void)
+{
+	ADCSRA = CLEAR;
+}
+
+/*See adc.h for details*/
+uint16_t get_adc_result(adc_channel ch)
+{
+	uint16_t result;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		result = filter[ch].ring[filter[ch].head];
+	}
+
+	return result;
+}
+
+/*See adc.h for details*/
+uint16_t get_adc_average(adc_channel ch)
+{
+	uint16_t sum;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		sum = filter[ch].ring_sum;
+	}
+
+	return sum >> RING_SHIFT;
+}
+
+/*See adc.h for details*/
+uint8_t get_adc_history(adc_channel ch, uint16_t *buf, uint8_t n)
+{
+	if(n > ADC_RING_SIZE) n = ADC_RING_SIZE;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		uint8_t idx = filter[ch].head;
+		for(uint8_t i = 0; i < n; i++)
+		{
+			buf[i] = filter[ch].ring[idx];
+			idx = (idx - 1) & RING_MASK;
+		}
+	}
+
+	return n;
+}
+
+/*See adc.h for details*/
+uint8_t get_adc_sequence(adc_channel ch)
+{
+	return filter[ch].seq;
+}
+
+/*See adc.h for details*/
+uint16_t adc_to_mv(uint16_t result)
+{
+	return (uint16_t)(((uint32_t)result * ADC_VREF_MV) >> ADC_RESULT_BITS);
+}
+
+/*See adc.h for details*/
+uint16_t get_battery_mv(void)
+{
+	return adc_to_mv(get_adc_average(ADC_BATTERY)) * BATTERY_DIVIDER;
+}
+/* End of adc.c */
@@ -0,0 +1,148 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Driver for the ATmega1284p analog-to-digital converter.
+ *    The ADC runs in free-running mode and is serviced entirely
+ *    by the conversion complete interrupt, which cycles through
+ *    the motor current sense and battery voltage channels. Each
+ *    channel is oversampled 16x and decimated to a 12-bit result,
+ *    and the most recent results are kept in a per-channel ring
+ *    with a running sum, so reads never wait on a conversion.
+ *
+ *    The inputs share PORTA with other peripherals; the pins
+ *    below must not be used as digital I/O while the ADC runs.
+ *    On the drill board only PA7 is free: PA5 and PA6 drive the
+ *    red and green status LEDs in control.c. By default only the
+ *    rotational current on PA7 is sampled and the other channels
+ *    read 0. Building with ADC_ALL_CHANNELS defined samples all
+ *    three, once the LEDs have been moved off PA5 and PA6.
+ *
+ **************************************************************/
+
+#ifndef ADC_H_
+#define ADC_H_
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include <stdint.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*ADC Input Pins (PORTA / ADC channel number)*/
+#define ROTAT_CURRENT_ADC 7 //Rotational motor driver CS output
+#define TRANS_CURRENT_ADC 6 //Translational motor driver CS output, GREEN_LED
+#define BATTERY_ADC       5 //Battery voltage divider, RED_LED
+
+/*Reference voltage (AVCC) in millivolts*/
+#define ADC_VREF_MV 5000UL
+
+/*Battery divider ratio (battery voltage / ADC pin voltage)*/
+#define BATTERY_DIVIDER 11UL
+
+/*Decimated result resolution*/
+#define ADC_RESULT_BITS 12
+#define ADC_RESULT_MAX  ((1UL << ADC_RESULT_BITS) - 1)
+
+/*Decimated results kept per channel (power of two)*/
+#define ADC_RING_SIZE 8
+
+/********************************************
+ * 		         Typedefs                   *
+ ********************************************/
+/*Sampled Channels*/
+typedef enum {
+	ADC_ROTAT_CURRENT = 0,
+	ADC_TRANS_CURRENT = 1,
+	ADC_BATTERY       = 2,
+	ADC_NUM_CHANNELS  = 3,
+}adc_channel;
+
+/*Channels actually sampled, from ADC_ROTAT_CURRENT up*/
+#ifdef ADC_ALL_CHANNELS
+#define ADC_SAMPLED_CHANNELS ADC_NUM_CHANNELS
+#else
+#define ADC_SAMPLED_CHANNELS 1
+#endif
+
+/********************************************
+ * 		      Function Prototypes           *
+ ********************************************/
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Configures the ADC for free-running, interrupt driven
+ *    conversions with AVCC as the reference and starts sampling.
+ *    Enables global interrupts. A new 12-bit result is produced
+ *    for every sampled channel at ~100Hz with all three channels,
+ *    or ~300Hz with the rotational current alone.
+ *
+ **************************************************************/
+void init_adc(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Stops conversions and disables the ADC.
+ *
+ **************************************************************/
+void stop_adc(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the most recent 12-bit result of a channel.
+ *
+ **************************************************************/
+uint16_t get_adc_result(adc_channel ch);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the mean of the results held in a channel's ring
+ *    (the last ADC_RING_SIZE results), as a 12-bit value. Reads
+ *    low until the ring has filled, ~80ms after init_adc().
+ *
+ **************************************************************/
+uint16_t get_adc_average(adc_channel ch);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Copies up to "n" of the newest results of a channel into
+ *    "buf", newest first. Returns the number of results copied.
+ *
+ **************************************************************/
+uint8_t get_adc_history(adc_channel ch, uint16_t *buf, uint8_t n);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns a free-running count of results produced for a
+ *    channel. A change indicates a new result is available.
+ *
+ **************************************************************/
+uint8_t get_adc_sequence(adc_channel ch);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Converts a 12-bit result to millivolts at the ADC pin.
+ *
+ **************************************************************/
+uint16_t adc_to_mv(uint16_t result);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the battery voltage in millivolts, from the ring
+ *    average of the battery channel.
+ *
+ **************************************************************/
+uint16_t get_battery_mv(void);
+
+#endif
+/* End of adc.h */
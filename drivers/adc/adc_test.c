@@ -0,0 +1,47 @@
+#define F_CPU 8000000UL
+
+#include "adc.h"
+#include "motor.h"
+#include "lcd_driver.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+
+/*Motor duty cycle while measuring current*/
+#define TEST_DUTY 128 //50%
+
+/*Display refresh period*/
+#define REFRESH_DELAY 500 //0.5 seconds
+
+/*From itoa.c*/
+extern char *num_to_str(int i);
+
+int main()
+{
+	initialize_LCD_driver();
+	init_motor_drivers();
+	brake_rotational_motor();
+	brake_translational_motor();
+	init_adc();
+
+	set_rotational_motor_speed(TEST_DUTY);
+	rotational_motor_right();
+
+	/*Display both motor currents (mA) and the battery voltage (mV),
+	  T and B read 0 unless built with ADC_ALL_CHANNELS*/
+	while(1)
+	{
+		lcd_erase();
+		lcd_puts("R:");
+		lcd_puts(num_to_str(get_rotational_motor_current()));
+		lcd_puts(" T:");
+		lcd_puts(num_to_str(get_translational_motor_current()));
+		lcd_goto_xy(1, 0);
+		lcd_puts("B:");
+		lcd_puts(num_to_str(get_battery_mv()));
+
+		_delay_ms(REFRESH_DELAY);
+	}
+
+	return 0;
+}
@@ -0,0 +1,206 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Implementation of the braking distance predictor. See
+ *    brake_predict.h for further details.
+ *
+ *    The fit is held as running sums of the observations, from
+ *    which the least squares line is solved after every stop:
+ *
+ *        b = (n*Svd - Sv*Sd) / (n*Svv - Sv*Sv)
+ *        a = (Sd - b*Sv) / n
+ *
+ *    With at most BRAKE_MAX_SAMPLES stops of velocities up to 255
+ *    counts per window and distances up to BRAKE_MAX_DIST counts,
+ *    every product of the solve fits in 32 bits. The slope is
+ *    found by long division, so no 64 bit arithmetic is needed.
+ *
+ **************************************************************/
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include "brake_predict.h"
+#include <avr/eeprom.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Identifies a valid fit in EEPROM*/
+#define BRAKE_MAGIC 0xB7A1
+
+/*Largest velocity accepted into the fit*/
+#define BRAKE_MAX_VEL 255
+
+/*Largest coast distance accepted into the fit, keeps n*Svd and Sv*Sd
+  below 2^31*/
+#define BRAKE_MAX_DIST 8191
+
+/*Bounds of the fitted line, well beyond any physical stop*/
+#define BRAKE_MAX_A (8192L << BRAKE_Q)
+#define BRAKE_MAX_B (64L << BRAKE_Q)
+
+/********************************************
+ * 		          Structs                   *
+ ********************************************/
+/*Observations and fitted line*/
+typedef struct {
+	uint16_t magic;
+	uint8_t n;    //Stops in the sums
+	int32_t sv;   //Sum of velocities
+	int32_t svv;  //Sum of squared velocities
+	int32_t sd;   //Sum of coast distances
+	int32_t svd;  //Sum of velocity times distance
+	int32_t a;    //Intercept (Q24.8 counts)
+	int32_t b;    //Slope (Q24.8 counts per count/window)
+}brake_model;
+
+/********************************************
+ * 	          Global Variables              *
+ ********************************************/
+/*Saved fit*/
+static brake_model EEMEM ee_model;
+
+/*Working fit*/
+static brake_model model;
+static bool dirty = false;
+
+/********************************************
+ * 	    Static Function Prototypes          *
+ ********************************************/
+static int32_t div_q8(int32_t num, int32_t den);
+static void solve_fit(void);
+
+/*Positive num / den in Q24.8, limited to BRAKE_MAX_B. The fraction
+  bits are found one at a time, the remainder stays below den*/
+static int32_t div_q8(int32_t num, int32_t den)
+{
+	int32_t q = num / den;
+	int32_t r = num % den;
+
+	if(q >= (BRAKE_MAX_B >> BRAKE_Q)) return BRAKE_MAX_B;
+
+	for(uint8_t i = 0; i < BRAKE_Q; i++)
+	{
+		q <<= 1;
+		r <<= 1;
+		if(r >= den)
+		{
+			q |= 1;
+			r -= den;
+		}
+	}
+
+	return q;
+}
+
+/*Refit the line to the sums, keeping the default slope until the
+  observations span enough velocities to define one*/
+static void solve_fit(void)
+{
+	int32_t n = model.n;
+	int32_t det = (n * model.svv) - (model.sv * model.sv);
+
+	if((model.n < BRAKE_MIN_SAMPLES) || (det <= 0))
+	{
+		model.a = BRAKE_DEFAULT_A;
+		model.b = BRAKE_DEFAULT_B;
+		return;
+	}
+
+	/*A stop never coasts backward*/
+	int32_t num = (n * model.svd) - (model.sv * model.sd);
+	int32_t b = (num > 0) ? div_q8(num, det) : 0;
+	int32_t a = ((model.sd << BRAKE_Q) - (b * model.sv)) / n;
+
+	if(a > BRAKE_MAX_A) a = BRAKE_MAX_A;
+	if(a < -BRAKE_MAX_A) a = -BRAKE_MAX_A;
+
+	model.b = b;
+	model.a = a;
+}
+
+/********************************************
+ * 		        API Functions               *
+ ********************************************/
+/*See brake_predict.h for details*/
+void init_brake_predictor(void)
+{
+	eeprom_read_block(&model, &ee_model, sizeof(model));
+
+	if((model.magic != BRAKE_MAGIC) || (model.n > BRAKE_MAX_SAMPLES))
+	{
+		reset_brake_predictor();
+	}
+	dirty = false;
+}
+
+/*See brake_predict.h for details*/
+uint16_t predict_brake_distance(uint16_t vel)
+{
+	if(vel > BRAKE_MAX_VEL) vel = BRAKE_MAX_VEL;
+
+	int32_t d = model.a + (model.b * vel);
+	if(d <= 0) return 0;
+
+	return (uint16_t)((d + (1L << (BRAKE_Q - 1))) >> BRAKE_Q);
+}
+
+/*See brake_predict.h for details*/
+void learn_brake_distance(uint16_t vel, uint16_t dist)
+{
+	if((vel == 0) || (vel > BRAKE_MAX_VEL)) return;
+	if(dist > BRAKE_MAX_DIST) dist = BRAKE_MAX_DIST;
+
+	/*Halve the weight of every stop so far, older stops fade out
+	  geometrically rather than being dropped*/
+	if(model.n >= BRAKE_MAX_SAMPLES)
+	{
+		model.n >>= 1;
+		model.sv >>= 1;
+		model.svv >>= 1;
+		model.sd >>= 1;
+		model.svd >>= 1;
+	}
+
+	model.n++;
+	model.sv += vel;
+	model.svv += (int32_t)vel * vel;
+	model.sd += dist;
+	model.svd += (int32_t)vel * dist;
+
+	solve_fit();
+	dirty = true;
+}
+
+/*See brake_predict.h for details*/
+void save_brake_predictor(void)
+{
+	if(!dirty) return;
+
+	eeprom_update_block(&model, &ee_model, sizeof(model));
+	dirty = false;
+}
+
+/*See brake_predict.h for details*/
+void reset_brake_predictor(void)
+{
+	model.magic = BRAKE_MAGIC;
+	model.n = 0;
+	model.sv = 0;
+	model.svv = 0;
+	model.sd = 0;
+	model.svd = 0;
+	solve_fit();
+	dirty = true;
+}
+
+/*See brake_predict.h for details*/
+uint8_t get_brake_samples(void)
+{
+	return model.n;
+}
+/* End of brake_predict.c */
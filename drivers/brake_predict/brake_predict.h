@@ -0,0 +1,113 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Learned braking distance predictor. A braked carriage runs
+ *    on for a distance that depends on its speed, the load and the
+ *    stop mode of its motor (see set_motor_stop_mode() in motor.h):
+ *    furthest when coasting, shorter with the default dynamic
+ *    braking and shortest with a plug brake. The predictor fits
+ *    the straight line
+ *
+ *        coast distance = a + b * velocity
+ *
+ *    to the coast distances observed at each stop by least squares
+ *    and uses it to decide how early to brake. Older stops are
+ *    gradually forgotten so the fit follows wear and temperature.
+ *    The fit only holds for the stop mode it was learned with, so
+ *    reset_brake_predictor() should be called when the mode is
+ *    changed. The fit is kept in EEPROM so it survives a power
+ *    cycle.
+ *
+ *    Velocities are in encoder counts per velocity window and
+ *    distances in encoder counts. The module does not depend on
+ *    any other driver.
+ *
+ **************************************************************/
+
+#ifndef BRAKE_PREDICT_H_
+#define BRAKE_PREDICT_H_
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include <stdint.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Fractional bits of the fit coefficients*/
+#define BRAKE_Q 8
+
+/*Model used until enough stops have been observed (Q24.8)*/
+#define BRAKE_DEFAULT_A 0                      //Counts
+#define BRAKE_DEFAULT_B (2L << BRAKE_Q)        //Counts per count/window
+
+/*Stops counted in the fit. Once full the sums are halved before each
+  new stop, so every stop's weight halves with each one learned after*/
+#define BRAKE_MAX_SAMPLES 32
+
+/*Stops needed before the fitted line is used*/
+#define BRAKE_MIN_SAMPLES 4
+
+/********************************************
+ * 		      Function Prototypes           *
+ ********************************************/
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Loads the fit from EEPROM, or starts from the default model
+ *    if no valid fit has been saved.
+ *
+ **************************************************************/
+void init_brake_predictor(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the predicted coast distance in counts after braking
+ *    at velocity "vel" (counts per window).
+ *
+ **************************************************************/
+uint16_t predict_brake_distance(uint16_t vel);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Adds an observed stop to the fit: the carriage was braked at
+ *    velocity "vel" and coasted "dist" counts. Distances beyond
+ *    8191 counts are taken as 8191.
+ *
+ **************************************************************/
+void learn_brake_distance(uint16_t vel, uint16_t dist);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Writes the fit to EEPROM if it has changed since it was last
+ *    saved. Blocks for several milliseconds per changed byte, so
+ *    it should be called while the motors are idle.
+ *
+ **************************************************************/
+void save_brake_predictor(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Discards all observed stops and returns to the default model.
+ *    The EEPROM copy is updated by the next save.
+ *
+ **************************************************************/
+void reset_brake_predictor(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the number of stops in the fit.
+ *
+ **************************************************************/
+uint8_t get_brake_samples(void);
+
+#endif
+/* End of brake_predict.h */
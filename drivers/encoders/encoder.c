@@ -18,6 +18,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 
 /********************************************
  * 		           Macros                   *
@@ -44,74 +45,74 @@
 /*Encoder Sampling Rate*/
 #define SAMPLING_RATE 200 // 5000 samples/sec
 
-/*Misc.*/
-#define A 1
-#define B 0
+/*Two bit mask covering the A and B channels of an encoder*/
+#define CHANNEL_MASK 0x03
+
+/*Packed encoder state bit positions*/
+#define ROTAT_SHIFT 0
+#define TRANS_SHIFT 2
+
+/*Transition table result fields*/
+#define ROTAT_EDGES_MASK 0x0F
+#define TRANS_EDGES_SHIFT 4
+
+/*The ISR samples both encoders with a single port read*/
+#if (TRANS_ENCODER_B_POS != (TRANS_ENCODER_A_POS + 1)) || \
+    (ROTAT_ENCODER_B_POS != (ROTAT_ENCODER_A_POS + 1))
+#error "Encoder B channels must directly follow their A channels"
+#endif
 
 /********************************************
  * 	          Global Variables              *
  ********************************************/
-/*Variables to hold translation encoder values*/
-volatile uint8_t curr_trans_encoder = 0;
-volatile uint8_t prev_trans_encoder = 0;
+/*Encoder counts shared with the API functions*/
 volatile uint16_t trans_encoder_cnt = 0;
-/*Variables to hold rotational encoder values*/
-volatile uint8_t curr_rotat_encoder = 0;
-volatile uint8_t prev_rotat_encoder = 0;
 volatile uint16_t rotat_encoder_cnt = 0;
 
-/********************************************
- * 	    Static Function Prototypes          *
- ********************************************/
-static bool read_trans_encoder_a(void);
-static bool read_trans_encoder_b(void);
-static bool read_rotat_encoder_a(void);
-static bool read_rotat_encoder_b(void);
-static void set_curr_trans_encoder_val(bool a, bool b); 
-static void set_curr_rotat_encoder_val(bool a, bool b); 
-
-/*Get value of translation encoder A*/
-static bool read_trans_encoder_a(void)
-{
-	return (PIN(TRANS_ENCODER_A_PORT) & (1 << TRANS_ENCODER_A_POS));
-}
+/*Encoder velocities (edges per window) shared with the API functions*/
+volatile uint16_t trans_encoder_vel = 0;
+volatile uint16_t rotat_encoder_vel = 0;
+/*Incremented every time new velocities are latched*/
+volatile uint8_t encoder_window_cnt = 0;
 
-/*Get value of translation encoder B*/
-static bool read_trans_encoder_b(void)
-{
-	return (PIN(TRANS_ENCODER_B_PORT) & (1 << TRANS_ENCODER_B_POS));
-}
+/*Called at the end of every velocity window*/
+static void (*volatile window_hook)(void) = 0;
 
-/*Get value of rotational encoder A*/
-static bool read_rotat_encoder_a(void)
-{
-	return (PIN(ROTAT_ENCODER_A_PORT) & (1 << ROTAT_ENCODER_A_POS));
-}
+/*Packed state of both encoders from the previous sample*/
+static uint8_t prev_encoder_state = 0;
 
-/*Get value of rotational encoder B*/
-static bool read_rotat_encoder_b(void)
-{
-	return (PIN(ROTAT_ENCODER_B_PORT) & (1 << ROTAT_ENCODER_B_POS));
-}
+/*Velocity window bookkeeping (ISR and clear functions only)*/
+static uint8_t window_ticks = ENCODER_VELOCITY_WINDOW;
+static uint16_t trans_window_start = 0;
+static uint16_t rotat_window_start = 0;
 
-/*Form a 2bit value from encoder inputs*/
-static void set_curr_trans_encoder_val(bool a, bool b)
-{
-	curr_trans_encoder = 0;
-	/*Set bit 1 if a is a = 1*/
-	if(a) curr_trans_encoder |= (1 << A);
-	/*Set bit 0 if b is b = 1*/
-	if(b) curr_trans_encoder |= (1 << B);
-}
+/*
+ * Edges seen by each encoder indexed by the 4bit change mask
+ * (previous packed state XOR current packed state). The packed
+ * state holds the rotational encoder in bits [1:0] and the
+ * translational encoder in bits [3:2]. Each entry holds the
+ * rotational edge count in the low nibble and the translational
+ * edge count in the high nibble. Both channels of an encoder
+ * changing between samples means a state was skipped, which is
+ * counted as two edges rather than one.
+ */
+static const uint8_t transition_table[16] = {
+	0x00, 0x01, 0x01, 0x02,
+	0x10, 0x11, 0x11, 0x12,
+	0x10, 0x11, 0x11, 0x12,
+	0x20, 0x21, 0x21, 0x22,
+};
+
+/********************************************
+ * 	    Static Function Prototypes          *
+ ********************************************/
+static uint8_t pack_encoder_state(uint8_t pins);
 
-/*Form a 2bit value from encoder inputs*/
-static void set_curr_rotat_encoder_val(bool a, bool b)
+/*Form a 4bit value holding both encoders from one port snapshot*/
+static inline uint8_t pack_encoder_state(uint8_t pins)
 {
-	curr_rotat_encoder = 0;
-	/*Set bit 1 if a is a = 1*/
-	if(a) curr_rotat_encoder |= (1 << A);
-	/*Set bit 0 if b is b = 1*/
-	if(b) curr_rotat_encoder |= (1 << B);
+	return ((((pins >> ROTAT_ENCODER_A_POS) & CHANNEL_MASK) << ROTAT_SHIFT) |
+	        (((pins >> TRANS_ENCODER_A_POS) & CHANNEL_MASK) << TRANS_SHIFT));
 }
 
 /********************************************
@@ -120,27 +121,37 @@ static void set_curr_rotat_encoder_val(bool a, bool b)
 /*ISR to sample the encoders at fixed intervals*/
 ISR(TIMER0_COMPA_vect)
 {
-	/*Read translation encoder inputs*/
-	bool tA = read_trans_encoder_a();
-	bool tB = read_trans_encoder_b();
-	set_curr_trans_encoder_val(tA,tB);
-	/*Read rotational encoder inputs*/
-	bool rA = read_rotat_encoder_a();
-	bool rB = read_rotat_encoder_b();
-	set_curr_rotat_encoder_val(rA,rB);
+	/*Read all encoder inputs at once*/
+	uint8_t curr = pack_encoder_state(PIN(ENCODER_PORT));
+	/*Look up the edges seen by both encoders*/
+	uint8_t edges = transition_table[curr ^ prev_encoder_state];
 	
-	/*Update translation encoder count*/
-	if(curr_trans_encoder != prev_trans_encoder)
+	if(edges)
 	{
-		trans_encoder_cnt++;
-		prev_trans_encoder = curr_trans_encoder;
+		prev_encoder_state = curr;
+		rotat_encoder_cnt += (edges & ROTAT_EDGES_MASK);
+		trans_encoder_cnt += (edges >> TRANS_EDGES_SHIFT);
 	}
 	
-	/*Update rotational encoder count*/
-	if(curr_rotat_encoder != prev_rotat_encoder)
+	/*Latch the edges seen over the last velocity window*/
+	if(--window_ticks == 0)
 	{
-		rotat_encoder_cnt++;
-		prev_rotat_encoder = curr_rotat_encoder;
+		window_ticks = ENCODER_VELOCITY_WINDOW;
+		trans_encoder_vel = trans_encoder_cnt - trans_window_start;
+		rotat_encoder_vel = rotat_encoder_cnt - rotat_window_start;
+		trans_window_start = trans_encoder_cnt;
+		rotat_window_start = rotat_encoder_cnt;
+		encoder_window_cnt++;
+
+		/*Run the window hook with interrupts enabled so that encoder
+		  samples are not missed. The next window is 50 samples away,
+		  so the hook cannot be entered twice.*/
+		void (*hook)(void) = window_hook;
+		if(hook)
+		{
+			sei();
+			hook();
+		}
 	}
 }
 
@@ -173,30 +184,91 @@ uint8_t get_sampling_rate(void)
 /*See encoder.h for details*/
 uint16_t get_trans_encoder_cnt(void)
 {
-	return trans_encoder_cnt;
+	uint16_t cnt;
+	/*Prevent the ISR from updating the count mid-read*/
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		cnt = trans_encoder_cnt;
+	}
+	return cnt;
 }
 
 /*See encoder.h for details*/
 uint16_t get_rotat_encoder_cnt(void)
 {
-	return rotat_encoder_cnt;
+	uint16_t cnt;
+	/*Prevent the ISR from updating the count mid-read*/
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		cnt = rotat_encoder_cnt;
+	}
+	return cnt;
 }
 
 /*See encoder.h for details*/
 void clear_trans_encoder_cnt(void)
 {
-	trans_encoder_cnt = 0;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		/*Keep the current velocity window consistent*/
+		trans_window_start -= trans_encoder_cnt;
+		trans_encoder_cnt = 0;
+	}
 }
 
 /*See encoder.h for details*/
 void clear_rotat_encoder_cnt(void)
 {
-	rotat_encoder_cnt = 0;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		/*Keep the current velocity window consistent*/
+		rotat_window_start -= rotat_encoder_cnt;
+		rotat_encoder_cnt = 0;
+	}
+}
+
+/*See encoder.h for details*/
+uint16_t get_trans_encoder_velocity(void)
+{
+	uint16_t vel;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		vel = trans_encoder_vel;
+	}
+	return vel;
+}
+
+/*See encoder.h for details*/
+uint16_t get_rotat_encoder_velocity(void)
+{
+	uint16_t vel;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		vel = rotat_encoder_vel;
+	}
+	return vel;
+}
+
+/*See encoder.h for details*/
+uint8_t get_encoder_window(void)
+{
+	return encoder_window_cnt;
+}
+
+/*See encoder.h for details*/
+void set_encoder_window_hook(void (*hook)(void))
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		window_hook = hook;
+	}
 }
 
 /*See encoder.h for details*/
 void start_encoders(void)
 {
+	/*Seed the previous state so the first sample is not counted*/
+	prev_encoder_state = pack_encoder_state(PIN(ENCODER_PORT));
 	/*Enable timer interrupts*/
 	TIMSK0 |= (1 << OCIE0A);
 	/*Start counter with divide by 8 prescaler*/
@@ -21,17 +21,36 @@
 /********************************************
  * 		           Macros                   *
  ********************************************/
+/*Encoder Input Port (all four channels are sampled with one read)*/
+#define ENCODER_PORT D
+
 /*Translation Motor Encoder Ports*/
-#define TRANS_ENCODER_A_PORT D
-#define TRANS_ENCODER_B_PORT D
+#define TRANS_ENCODER_A_PORT ENCODER_PORT
+#define TRANS_ENCODER_B_PORT ENCODER_PORT
 #define TRANS_ENCODER_A_POS  4
-#define TRANS_ENCODER_B_POS  5
+#define TRANS_ENCODER_B_POS  5 //Must be TRANS_ENCODER_A_POS + 1
 
 /*Rotational Motor Encoder Ports*/
-#define ROTAT_ENCODER_A_PORT D
-#define ROTAT_ENCODER_B_PORT D
+#define ROTAT_ENCODER_A_PORT ENCODER_PORT
+#define ROTAT_ENCODER_B_PORT ENCODER_PORT
 #define ROTAT_ENCODER_A_POS  0
-#define ROTAT_ENCODER_B_POS  1
+#define ROTAT_ENCODER_B_POS  1 //Must be ROTAT_ENCODER_A_POS + 1
+
+/*Encoder samples per velocity measurement window (~10ms)*/
+#define ENCODER_VELOCITY_WINDOW 50
+
+/*Fastest velocity the sampler can measure (edges per window). The
+  encoders are sampled at ~4975Hz and a clean quadrature count needs
+  less than one edge per sample, faster encoders skip states and
+  their counts alias. Speed targets must stay below this.*/
+#define ENCODER_MAX_VELOCITY ENCODER_VELOCITY_WINDOW
+
+/*Velocity windows per second*/
+#define ENCODER_WINDOW_HZ 100
+
+/*Rotational encoder edges per auger revolution, all edges of a
+  64 CPR motor encoder behind a 70:1 gearbox*/
+#define ROTAT_EDGES_PER_REV 4480UL
 
 /********************************************
  * 		      Function Prototypes           *
@@ -94,6 +113,49 @@ void clear_trans_encoder_cnt(void);
  **************************************************************/
 void clear_rotat_encoder_cnt(void);
 
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the number of translational encoder edges counted
+ *    during the last complete velocity window. The window length
+ *    is ENCODER_VELOCITY_WINDOW encoder samples.
+ *
+ **************************************************************/
+uint16_t get_trans_encoder_velocity(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the number of rotational encoder edges counted
+ *    during the last complete velocity window. The window length
+ *    is ENCODER_VELOCITY_WINDOW encoder samples.
+ *
+ **************************************************************/
+uint16_t get_rotat_encoder_velocity(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns a free-running count of completed velocity windows.
+ *    A change in the returned value indicates new velocities are
+ *    available. Intended as a fixed rate tick for control loops.
+ *
+ **************************************************************/
+uint8_t get_encoder_window(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Registers a function to be called from the encoder ISR at the
+ *    end of every velocity window, right after the new velocities
+ *    are latched. The function runs with interrupts enabled again
+ *    and must return well within one window. Control loops that
+ *    must keep running whatever the application loop is doing are
+ *    driven from here. Passing 0 removes the hook.
+ *
+ **************************************************************/
+void set_encoder_window_hook(void (*hook)(void));
+
 /***************************************************************
  *
  * DESCRIPTION:
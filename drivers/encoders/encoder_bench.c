@@ -0,0 +1,255 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Cycle budget benchmark for the encoder sampling ISR.
+ *    Timer/Counter1 runs from the undivided system clock and
+ *    is read around a direct call of the Timer0 compare vector.
+ *    The idle path (no encoder edges) and the edge path are
+ *    measured separately, leaving out the calls that end a
+ *    velocity window. Edges are produced by toggling the encoder
+ *    input pull-ups, so no hardware needs to be attached.
+ *
+ *    The calls that end a window are then timed on their own,
+ *    first with no window hook (the velocity latch alone) and then
+ *    with an empty hook, which adds the nested sei() and the hook
+ *    call. Both are paid once per window on top of the idle path.
+ *
+ *    The original ISR, which read each channel separately and
+ *    compared the encoders one at a time, is kept below and timed
+ *    the same way. Both get the same interrupt prologue and
+ *    epilogue, so the figures compare directly.
+ *
+ *    Intended to be run under simavr: break on bench_done() and
+ *    inspect the cycle counts, or read them from the LCD on real
+ *    hardware. The LCD alternates between the sampling figures (old
+ *    ISR on the first row, new ISR on the second) and the window
+ *    figures (W: latch only, H: latch and hook).
+ *
+ *      make bench
+ *
+ **************************************************************/
+
+#define F_CPU 8000000UL
+
+#include "encoder.h"
+#include "lcd_driver.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*Timer1 Clock Select Bits*/
+#define CS10 0
+
+/*Number of ISR calls averaged per measurement*/
+#define BENCH_RUNS 64
+
+/*Time each set of results is shown on the LCD (ms)*/
+#define SHOW_MS 2000
+
+/*Encoder input pull-ups toggled to create edges*/
+#define EDGE_MASK ((1 << TRANS_ENCODER_A_POS) | (1 << ROTAT_ENCODER_A_POS))
+
+/*Concatenation Macros*/
+#define CONCAT(A,B) (A##B)
+#define PORT(letter) CONCAT(PORT,letter)
+#define PIN(letter) CONCAT(PIN,letter)
+
+/*Bit positions of the original 2bit encoder values*/
+#define A 1
+#define B 0
+
+/*From itoa.c*/
+extern char *num_to_str(int i);
+
+/*Encoder sampling ISR defined in encoder.c*/
+void TIMER0_COMPA_vect(void);
+
+/*Original encoder sampling ISR, compiled as an interrupt handler
+  (the __vector prefix keeps avr-gcc from warning about the name)*/
+void __vector_baseline_encoder(void) __attribute__((signal, used));
+
+/*Original ISR state*/
+volatile uint8_t curr_trans_encoder = 0;
+volatile uint8_t prev_trans_encoder = 0;
+volatile uint16_t base_trans_cnt = 0;
+volatile uint8_t curr_rotat_encoder = 0;
+volatile uint8_t prev_rotat_encoder = 0;
+volatile uint16_t base_rotat_cnt = 0;
+
+/*Results in CPU cycles per ISR call (including call and reti)*/
+volatile uint16_t old_idle_cycles = 0;
+volatile uint16_t old_edge_cycles = 0;
+volatile uint16_t idle_cycles = 0;
+volatile uint16_t edge_cycles = 0;
+volatile uint16_t window_cycles = 0; //Call ending a window, no hook
+volatile uint16_t hook_cycles = 0;   //Call ending a window, empty hook
+
+/*Cost of the back to back counter reads*/
+static uint16_t timer_overhead = 0;
+
+/*Break point for the simulator*/
+void __attribute__((noinline)) bench_done(void)
+{
+	__asm__ __volatile__("nop");
+}
+
+/*Form a 2bit value from encoder inputs, as the original driver*/
+static void set_curr_trans_encoder_val(bool a, bool b)
+{
+	curr_trans_encoder = 0;
+	if(a) curr_trans_encoder |= (1 << A);
+	if(b) curr_trans_encoder |= (1 << B);
+}
+
+/*Form a 2bit value from encoder inputs, as the original driver*/
+static void set_curr_rotat_encoder_val(bool a, bool b)
+{
+	curr_rotat_encoder = 0;
+	if(a) curr_rotat_encoder |= (1 << A);
+	if(b) curr_rotat_encoder |= (1 << B);
+}
+
+/*Original ISR body from before the transition table*/
+void __vector_baseline_encoder(void)
+{
+	bool tA = PIN(TRANS_ENCODER_A_PORT) & (1 << TRANS_ENCODER_A_POS);
+	bool tB = PIN(TRANS_ENCODER_B_PORT) & (1 << TRANS_ENCODER_B_POS);
+	set_curr_trans_encoder_val(tA,tB);
+	bool rA = PIN(ROTAT_ENCODER_A_PORT) & (1 << ROTAT_ENCODER_A_POS);
+	bool rB = PIN(ROTAT_ENCODER_B_PORT) & (1 << ROTAT_ENCODER_B_POS);
+	set_curr_rotat_encoder_val(rA,rB);
+
+	if(curr_trans_encoder != prev_trans_encoder)
+	{
+		base_trans_cnt++;
+		prev_trans_encoder = curr_trans_encoder;
+	}
+
+	if(curr_rotat_encoder != prev_rotat_encoder)
+	{
+		base_rotat_cnt++;
+		prev_rotat_encoder = curr_rotat_encoder;
+	}
+}
+
+/*Empty window hook, so only the cost of calling it is measured*/
+static void bench_hook(void)
+{
+}
+
+/*Measure one call of an ISR*/
+static uint16_t time_call(void (*isr)(void))
+{
+	uint16_t start, stop;
+
+	cli();
+	start = TCNT1;
+	isr();
+	stop = TCNT1;
+
+	return (uint16_t)(stop - start - timer_overhead);
+}
+
+/*Measure the average length of one call of an ISR, leaving out the
+  calls that end a velocity window*/
+static uint16_t time_isr(void (*isr)(void), bool toggle)
+{
+	uint32_t total = 0;
+	uint8_t runs = 0;
+
+	while(runs < BENCH_RUNS)
+	{
+		if(toggle) PORT(ENCODER_PORT) ^= EDGE_MASK;
+		uint8_t window = get_encoder_window();
+		uint16_t cycles = time_call(isr);
+		if(get_encoder_window() != window) continue;
+		total += cycles;
+		runs++;
+	}
+
+	return (uint16_t)(total / BENCH_RUNS);
+}
+
+/*Measure the average length of the calls of the new ISR that end a
+  velocity window, with the given window hook installed*/
+static uint16_t time_window(void (*hook)(void))
+{
+	uint32_t total = 0;
+	uint8_t window = get_encoder_window();
+
+	set_encoder_window_hook(hook);
+
+	/*Run to the start of a window*/
+	while(get_encoder_window() == window) time_call(TIMER0_COMPA_vect);
+
+	for(uint8_t i = 0; i < BENCH_RUNS; i++)
+	{
+		for(uint8_t j = 1; j < ENCODER_VELOCITY_WINDOW; j++)
+		{
+			time_call(TIMER0_COMPA_vect);
+		}
+		total += time_call(TIMER0_COMPA_vect);
+	}
+
+	set_encoder_window_hook(0);
+
+	return (uint16_t)(total / BENCH_RUNS);
+}
+
+/*Print one row of results*/
+static void show_cycles(char *label, uint16_t idle, uint16_t edge)
+{
+	lcd_puts(label);
+	lcd_puts(" I:");
+	lcd_puts(num_to_str(idle));
+	lcd_puts(" E:");
+	lcd_puts(num_to_str(edge));
+}
+
+int main()
+{
+	initialize_LCD_driver();
+	init_encoders();
+	/*Keep the timer interrupt off, the vectors are called directly*/
+	stop_encoders();
+
+	/*Run Timer1 at the full system clock*/
+	TCCR1A = 0;
+	TCCR1B = (1 << CS10);
+
+	uint16_t start = TCNT1;
+	uint16_t stop = TCNT1;
+	timer_overhead = stop - start;
+
+	old_idle_cycles = time_isr(__vector_baseline_encoder, false);
+	old_edge_cycles = time_isr(__vector_baseline_encoder, true);
+	idle_cycles = time_isr(TIMER0_COMPA_vect, false);
+	edge_cycles = time_isr(TIMER0_COMPA_vect, true);
+	window_cycles = time_window(0);
+	hook_cycles = time_window(bench_hook);
+	sei();
+
+	bench_done();
+
+	while(1)
+	{
+		lcd_erase();
+		show_cycles("OLD", old_idle_cycles, old_edge_cycles);
+		lcd_goto_xy(1, 0);
+		show_cycles("NEW", idle_cycles, edge_cycles);
+		_delay_ms(SHOW_MS);
+
+		lcd_erase();
+		lcd_puts("WIN W:");
+		lcd_puts(num_to_str(window_cycles));
+		lcd_puts(" H:");
+		lcd_puts(num_to_str(hook_cycles));
+		_delay_ms(SHOW_MS);
+	}
+
+	return 0;
+}
+/* End of encoder_bench.c */
@@ -0,0 +1,142 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Implementation of the torque-adaptive feed rate controller.
+ *    See feed_ctl.h for further details.
+ *
+ **************************************************************/
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include "feed_ctl.h"
+#include "pid.h"
+#include "profile.h"
+#include "trans_axis.h"
+#include "speed_ctl.h"
+#include "encoder.h"
+#include "motor.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 	          Global Variables              *
+ ********************************************/
+/*Feed rate PID state*/
+static pid_ctl feed_pid;
+
+/*Load measurement in use*/
+static feed_load_source load_src = FEED_LOAD_DROOP;
+
+/*Target load and filtered load scaled by 2^FEED_LOAD_FILTER*/
+static int16_t load_target = FEED_DROOP_TARGET;
+static int32_t load_acc = 0;
+
+/*Feed rate last applied to the axis (counts per window)*/
+static uint16_t feed_rate = FEED_MIN_VEL;
+
+/*Encoder window handled by the last update*/
+static uint8_t last_window = 0;
+
+/********************************************
+ * 	    Static Function Prototypes          *
+ ********************************************/
+static int16_t measure_load(void);
+
+/*Unfiltered auger load in the units of the load source*/
+static int16_t measure_load(void)
+{
+	if(load_src == FEED_LOAD_CURRENT)
+	{
+		uint16_t ma = get_rotational_motor_current();
+		return (ma > INT16_MAX) ? INT16_MAX : (int16_t)ma;
+	}
+
+	return (int16_t)get_rotat_speed_target() -
+	       (int16_t)get_rotat_encoder_velocity();
+}
+
+/********************************************
+ * 		        API Functions               *
+ ********************************************/
+/*See feed_ctl.h for details*/
+void init_feed_ctl(feed_load_source src, int16_t target_load)
+{
+	load_src = src;
+	load_target = target_load;
+	load_acc = 0;
+
+	if(src == FEED_LOAD_CURRENT)
+	{
+		init_pid(&feed_pid, FEED_CURRENT_KP, FEED_CURRENT_KI, FEED_CURRENT_KD,
+		         FEED_MIN_VEL, FEED_MAX_VEL);
+	}
+	else
+	{
+		init_pid(&feed_pid, FEED_DROOP_KP, FEED_DROOP_KI, FEED_DROOP_KD,
+		         FEED_MIN_VEL, FEED_MAX_VEL);
+	}
+
+	/*Start slow, the integral term raises the feed in soft ground*/
+	reset_pid(&feed_pid, FEED_MIN_VEL);
+	feed_rate = FEED_MIN_VEL;
+	set_trans_axis_limits(PROFILE_LIMIT(FEED_MIN_VEL), TRANS_AXIS_MAX_ACC,
+	                      TRANS_AXIS_MAX_JERK);
+	last_window = get_encoder_window();
+}
+
+/*See feed_ctl.h for details*/
+void set_feed_gains(int16_t kp, int16_t ki, int16_t kd)
+{
+	set_pid_gains(&feed_pid, kp, ki, kd);
+}
+
+/*See feed_ctl.h for details*/
+void set_feed_limits(uint16_t min_vel, uint16_t max_vel)
+{
+	/*The axis velocity limit is Q8.8*/
+	if(max_vel > (UINT16_MAX >> PROFILE_Q)) max_vel = UINT16_MAX >> PROFILE_Q;
+	if(min_vel > max_vel) min_vel = max_vel;
+
+	set_pid_limits(&feed_pid, (int16_t)min_vel, (int16_t)max_vel);
+}
+
+/*See feed_ctl.h for details*/
+void set_feed_target_load(int16_t target_load)
+{
+	load_target = target_load;
+}
+
+/*See feed_ctl.h for details*/
+int16_t get_feed_load(void)
+{
+	return (int16_t)(load_acc >> FEED_LOAD_FILTER);
+}
+
+/*See feed_ctl.h for details*/
+uint16_t get_feed_rate(void)
+{
+	return feed_rate;
+}
+
+/*See feed_ctl.h for details*/
+bool update_feed_ctl(void)
+{
+	uint8_t window = get_encoder_window();
+
+	/*Run once per velocity window*/
+	if(window == last_window) return false;
+	last_window = window;
+
+	/*Smooth the window to window noise of the load measurement*/
+	load_acc += measure_load() - (load_acc >> FEED_LOAD_FILTER);
+
+	/*Load below the target raises the feed rate*/
+	feed_rate = (uint16_t)update_pid(&feed_pid, load_target, get_feed_load());
+	set_trans_axis_limits(PROFILE_LIMIT(feed_rate), TRANS_AXIS_MAX_ACC,
+	                      TRANS_AXIS_MAX_JERK);
+
+	return true;
+}
+/* End of feed_ctl.c */
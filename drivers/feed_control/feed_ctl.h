@@ -0,0 +1,139 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Torque-adaptive feed rate control for drilling. A PID
+ *    controller compares the load on the auger against a target
+ *    load and sets the velocity limit of the translational axis
+ *    (see trans_axis.h), so soft ground is drilled at the maximum
+ *    feed rate and the feed slows down in hard ground before the
+ *    auger stalls. The controller runs once per encoder velocity
+ *    window (~100Hz).
+ *
+ *    The auger load is measured either as rotational speed droop
+ *    (speed target minus encoder velocity, in edges per window) or
+ *    as rotational motor current (mA, requires init_adc()). While
+ *    the speed controller is running, droop only appears once it
+ *    runs out of duty cycle, so a droop target holds the auger just
+ *    past the edge of its available torque.
+ *
+ **************************************************************/
+
+#ifndef FEED_CTL_H_
+#define FEED_CTL_H_
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "pid.h"
+#include "speed_ctl.h"
+#include "trans_axis.h"
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Default feed rate range (whole counts per window), up to the
+  velocity limit of the translational axis*/
+#define FEED_MIN_VEL 8
+#define FEED_MAX_VEL (TRANS_AXIS_MAX_VEL >> PROFILE_Q)
+
+/*Default target loads*/
+#define FEED_DROOP_TARGET   (ROTAT_DRILL_SPEED / 10) //Edges per window
+#define FEED_CURRENT_TARGET 8000                     //mA
+
+/*Default gains for each load source (Q8.8, feed per unit load)*/
+#define FEED_DROOP_KP   PID_GAIN(2.0)
+#define FEED_DROOP_KI   PID_GAIN(0.25)
+#define FEED_DROOP_KD   PID_GAIN(0)
+#define FEED_CURRENT_KP PID_GAIN(0.02)
+#define FEED_CURRENT_KI PID_GAIN(0.004)
+#define FEED_CURRENT_KD PID_GAIN(0)
+
+/*Load filter, each update moves 1/2^FEED_LOAD_FILTER of the way*/
+#define FEED_LOAD_FILTER 2
+
+/********************************************
+ * 		          Typedefs                  *
+ ********************************************/
+/*Auger Load Measurements*/
+typedef enum {
+	FEED_LOAD_DROOP   = 0, //Rotational speed droop (edges/window)
+	FEED_LOAD_CURRENT = 1, //Rotational motor current (mA)
+}feed_load_source;
+
+/********************************************
+ * 		      Function Prototypes           *
+ ********************************************/
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Initializes the feed controller with the default gains and
+ *    feed range of the given load source, holding "target_load".
+ *    The feed rate starts at the minimum and rises while the load
+ *    is below the target. The translational axis and rotational
+ *    speed controller must be initialized first.
+ *
+ **************************************************************/
+void init_feed_ctl(feed_load_source src, int16_t target_load);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Changes the controller gains. Values are Q8.8, see PID_GAIN()
+ *    in pid.h.
+ *
+ **************************************************************/
+void set_feed_gains(int16_t kp, int16_t ki, int16_t kd);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Sets the range the feed rate is kept within, in whole
+ *    encoder counts per window (at most 255).
+ *
+ **************************************************************/
+void set_feed_limits(uint16_t min_vel, uint16_t max_vel);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Sets the auger load to hold, in the units of the load source.
+ *
+ **************************************************************/
+void set_feed_target_load(int16_t target_load);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the filtered auger load in the units of the load
+ *    source.
+ *
+ **************************************************************/
+int16_t get_feed_load(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the feed rate most recently applied to the
+ *    translational axis, in counts per window.
+ *
+ **************************************************************/
+uint16_t get_feed_rate(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Measures the auger load and updates the translational axis
+ *    velocity limit if a new encoder velocity window has completed
+ *    since the last update. Should be called from the application
+ *    loop at least once per window (10ms). Returns true if the
+ *    controller ran.
+ *
+ **************************************************************/
+bool update_feed_ctl(void);
+
+#endif
+/* End of feed_ctl.h */
@@ -0,0 +1,99 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host simulation of the feed rate controller. Runs feed_ctl.c
+ *    with the real PID against a simple auger model in place of
+ *    the speed controller, encoders and translational axis. Each
+ *    step of the model is one encoder velocity window.
+ *
+ *    The auger load grows with the feed rate and the hardness of
+ *    the ground. The speed controller holds the auger at its target
+ *    until the load passes what full duty can deliver, after which
+ *    the auger speed droops. The ground is soft, then hard, then
+ *    soft again.
+ *
+ *    The model constants are estimates and should be replaced
+ *    with values measured on the drill.
+ *
+ *      make sim
+ *
+ **************************************************************/
+
+#include "feed_ctl.h"
+#include "profile.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*Auger model*/
+#define SPEED_TARGET ROTAT_DRILL_SPEED //Speed controller target (edges/window)
+#define TORQUE_LIMIT 50.0  //Load the speed controller can hold
+#define DROOP_GAIN   0.2   //Droop per unit of load past the limit
+#define SPEED_LAG    5.0   //Windows for the auger speed to settle
+
+/*Ground hardness (load per unit feed) and length of each layer*/
+#define SOFT_GROUND  0.5
+#define HARD_GROUND  4.0
+#define LAYER_WINDOWS 300
+
+/*Windows between printed lines*/
+#define PRINT_WINDOWS 30
+
+/*Model state*/
+static double auger_vel = SPEED_TARGET; //Edges per window
+static double axis_vel_limit = 0;       //Feed rate (counts per window)
+static uint8_t window = 0;
+
+/*Speed controller, encoder, motor and axis stand-ins*/
+uint8_t get_encoder_window(void) { return window; }
+uint16_t get_rotat_speed_target(void) { return SPEED_TARGET; }
+uint16_t get_rotat_encoder_velocity(void) { return (uint16_t)auger_vel; }
+uint16_t get_rotational_motor_current(void) { return 0; }
+
+void set_trans_axis_limits(uint16_t vel, uint16_t acc, uint16_t jerk)
+{
+	(void)acc;
+	(void)jerk;
+	axis_vel_limit = (double)vel / (1 << PROFILE_Q);
+}
+
+/*Advances the auger by one velocity window*/
+static void step(double hardness)
+{
+	double load = axis_vel_limit * hardness;
+	double vel = SPEED_TARGET;
+
+	if(load > TORQUE_LIMIT) vel -= (load - TORQUE_LIMIT) * DROOP_GAIN;
+	if(vel < 0) vel = 0;
+
+	auger_vel += (vel - auger_vel) / SPEED_LAG;
+	window++;
+}
+
+int main(void)
+{
+	init_feed_ctl(FEED_LOAD_DROOP, FEED_DROOP_TARGET);
+
+	printf("Droop target %d edges/window, feed %d to %d counts/window\n",
+	       FEED_DROOP_TARGET, FEED_MIN_VEL, FEED_MAX_VEL);
+
+	for(int t = 0; t < 3 * LAYER_WINDOWS; t++)
+	{
+		double hardness = (t / LAYER_WINDOWS == 1) ? HARD_GROUND : SOFT_GROUND;
+
+		step(hardness);
+		update_feed_ctl();
+
+		if((t % PRINT_WINDOWS) == 0)
+		{
+			printf("  window %3d, %s ground: feed %3u, load %3d, "
+			       "auger %3.0f edges/window\n",
+			       t, (hardness == HARD_GROUND) ? "hard" : "soft",
+			       get_feed_rate(), get_feed_load(), auger_vel);
+		}
+	}
+
+	return 0;
+}
+/* End of feed_ctl_sim.c */
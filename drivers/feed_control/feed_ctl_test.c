@@ -0,0 +1,66 @@
+#define F_CPU 8000000UL
+
+#include "feed_ctl.h"
+#include "speed_ctl.h"
+#include "trans_axis.h"
+#include "encoder.h"
+#include "motor.h"
+#include "lcd_driver.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*Auger speed in edges per window*/
+#define AUGER_SPEED ROTAT_DRILL_SPEED
+
+/*Test descent in encoder counts*/
+#define TEST_DIST 32000L
+
+/*From itoa.c*/
+extern char *num_to_str(int i);
+
+int main()
+{
+	uint8_t windows = 0;
+
+	sei();
+
+	initialize_LCD_driver();
+	init_encoders();
+	init_motor_drivers();
+	brake_rotational_motor();
+	brake_translational_motor();
+	start_encoders();
+
+	init_trans_axis();
+	init_rotat_speed_ctl();
+	set_rotat_speed_target(AUGER_SPEED);
+	init_feed_ctl(FEED_LOAD_DROOP, FEED_DROOP_TARGET);
+
+	/*Drill down, displaying the auger load and feed rate*/
+	rotational_motor_right();
+	trans_axis_move_to(TEST_DIST);
+
+	while(!trans_axis_done())
+	{
+		update_feed_ctl();
+		if(!update_trans_axis()) continue;
+
+		/*Refresh display every ~0.5 seconds*/
+		if(++windows == 50)
+		{
+			windows = 0;
+			lcd_erase();
+			lcd_puts("L:");
+			lcd_puts(num_to_str(get_feed_load()));
+			lcd_puts(" F:");
+			lcd_puts(num_to_str(get_feed_rate()));
+		}
+	}
+
+	brake_rotational_motor();
+	stop_trans_axis();
+
+	while(1);
+
+	return 0;
+}
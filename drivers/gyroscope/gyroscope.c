@@ -37,6 +37,7 @@
 #define CTRL_REG1 0x20
 #define CTRL_REG4 0x23
 #define CTRL_REG5 0x24
+#define OUT_TEMP  0x26
 #define OUT_X_L   0x28
 #define OUT_X_H   0x29
 #define OUT_Y_L   0x2A
@@ -351,4 +352,20 @@ bool read_gyroscope(gyro_data *data)
 	
 	return GYRO_READ_PASS;
 }
+
+/*See gyro_driver.h for details*/
+bool read_gyro_temp(int8_t *temp)
+{
+	int8_t raw = 0;
+
+	if(read_n_consec_regs((uint8_t *)&raw,(uint8_t)OUT_TEMP,1) == GYRO_READ_FAIL)
+	{
+		return GYRO_READ_FAIL;
+	}
+
+	/*One count per degree, the reading falls as temperature rises*/
+	*temp = (int8_t)(GYRO_TEMP_REF - raw);
+
+	return GYRO_READ_PASS;
+}
 /*End gyro_driver.c */
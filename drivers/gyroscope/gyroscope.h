@@ -21,6 +21,7 @@
  * 		          Includes                  *
  ********************************************/ 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdfix.h>
 
 /********************************************
@@ -34,6 +35,10 @@
 #define GYRO_WRITE_FAIL	0
 #define GYRO_WRITE_PASS 1
 
+/*Temperature in Celsius at which OUT_TEMP Reads Zero, the Sensor
+  is Uncalibrated and this Should be Measured per Device*/
+#define GYRO_TEMP_REF 25
+
 /********************************************
  * 		          Typedefs                  *
  ********************************************/
@@ -100,6 +105,16 @@ void disable_autorange(void);
  *
  **************************************************************/
 bool read_gyroscope(gyro_data *data);
+
+ /***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Reads the L3GD20 die temperature in degrees Celsius into
+ *    "temp". The sensor has a resolution of one degree and only
+ *    measures changes, so GYRO_TEMP_REF sets the absolute value.
+ *
+ **************************************************************/
+bool read_gyro_temp(int8_t *temp);
  
 #endif
 /* End of gyro_driver.h */
@@ -0,0 +1,166 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Implementation of the height above ground estimator. See
+ *    height.h for further details.
+ *
+ **************************************************************/
+
+/*Processor Frequency*/
+#define F_CPU 8000000UL
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include "height.h"
+#include "height_kf.h"
+#include "accelerometer.h"
+#include "ultrasonic.h"
+#include <util/delay.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Accelerometer data period (ms)*/
+#define ACCEL_PERIOD_MS 10
+
+/*Converts m/s^2 to mm/s^2*/
+#define MM_PER_M 1000
+
+/********************************************
+ * 	          Global Variables              *
+ ********************************************/
+/*Height and velocity filter*/
+static height_kf kf;
+
+/*Acceleration at rest, gravity plus offset (mm/s^2)*/
+static int32_t accel_rest = 0;
+
+/*Time of the last update and of the last accepted range (us)*/
+static uint32_t last_time = 0;
+static uint32_t fix_time = 0;
+
+/*Last reading of each sensor used*/
+static uint8_t last_count[NUM_SENSORS];
+
+/********************************************
+ * 	    Static Function Prototypes          *
+ ********************************************/
+static bool read_vert_accel(int32_t *accel);
+static void fuse_range(sensor id, uint32_t now);
+
+/*Reads the z-axis acceleration in mm/s^2*/
+static bool read_vert_accel(int32_t *accel)
+{
+	accel_data data;
+
+	if(read_accel(&data) == ACCEL_READ_FAIL) return false;
+
+	/*Scale in 32 bits, the product overflows an accum above 65m/s^2
+	  (6.7g). Only the fraction, always below 1, is scaled as an accum.*/
+	int32_t whole = (int32_t)data.z;
+	*accel = whole * MM_PER_M + (int32_t)((data.z - whole) * MM_PER_M);
+
+	return true;
+}
+
+/*Corrects the filter with a new reading of a sensor*/
+static void fuse_range(sensor id, uint32_t now)
+{
+	uint8_t count;
+	uint16_t range;
+	uint32_t ping;
+
+	/*Read again if a reading arrived in between*/
+	do
+	{
+		count = get_range_count(id);
+		range = get_range_mm(id);
+		ping = get_range_time(id);
+	} while(count != get_range_count(id));
+
+	if(count == last_count[id]) return;
+	last_count[id] = count;
+
+	if(range == ULTRASONIC_TIMEOUT) return;
+
+	/*Height now, from the height when the sensor was pinged*/
+	int32_t age_ms = (int32_t)((now - ping) / 1000);
+	int32_t height = range + (get_height_kf_vel(&kf) * age_ms) / 1000;
+
+	if(correct_height_kf(&kf, height, HEIGHT_RANGE_SD)) fix_time = now;
+}
+
+/********************************************
+ * 		        API Functions               *
+ ********************************************/
+/*See height.h for details*/
+bool init_height_estimator(void)
+{
+	int32_t sum = 0;
+
+	/*Gravity and offset while still*/
+	for(uint8_t i = 0; i < HEIGHT_CAL_SAMPLES; i++)
+	{
+		int32_t accel;
+
+		if(!read_vert_accel(&accel)) return false;
+		sum += accel;
+		_delay_ms(ACCEL_PERIOD_MS);
+	}
+	accel_rest = sum / HEIGHT_CAL_SAMPLES;
+
+	init_height_kf(&kf, HEIGHT_ACCEL_SD);
+	start_ultrasonic_ranging();
+
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
+	{
+		last_count[id] = get_range_count(id);
+	}
+	last_time = get_ultrasonic_time();
+	fix_time = last_time;
+
+	return true;
+}
+
+/*See height.h for details*/
+bool update_height(void)
+{
+	int32_t accel;
+	bool status = read_vert_accel(&accel);
+	uint32_t now = get_ultrasonic_time();
+
+	accel = status ? (accel - accel_rest) : 0;
+
+	predict_height_kf(&kf, accel, now - last_time);
+	last_time = now;
+
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
+	{
+		fuse_range(id, now);
+	}
+
+	return status;
+}
+
+/*See height.h for details*/
+int16_t get_height_mm(void)
+{
+	return (int16_t)get_height_kf(&kf);
+}
+
+/*See height.h for details*/
+int16_t get_vert_speed(void)
+{
+	return (int16_t)get_height_kf_vel(&kf);
+}
+
+/*See height.h for details*/
+bool height_valid(void)
+{
+	return kf.locked && ((last_time - fix_time) < HEIGHT_STALE_US);
+}
+/* End of height.c */
@@ -0,0 +1,100 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Height above ground estimator. Vertical acceleration from the
+ *    accelerometer drives a Kalman filter (see height_kf.h) that
+ *    is corrected by every new range from ultrasonic sensors A and
+ *    B, so height and vertical velocity are updated at the
+ *    accelerometer data rate (100Hz) rather than the 16Hz at which
+ *    each sensor is pinged.
+ *
+ *    The accelerometer z-axis is assumed to point up. Gravity and
+ *    the accelerometer offset are measured while the drill is
+ *    still, in init_height_estimator(). A range is moved forward
+ *    from the time of its ping to the time of the update using the
+ *    estimated velocity.
+ *
+ **************************************************************/
+
+#ifndef HEIGHT_H_
+#define HEIGHT_H_
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Standard deviation of the vertical acceleration input (mm/s^2)*/
+#define HEIGHT_ACCEL_SD 500
+
+/*Standard deviation of an ultrasonic range (mm)*/
+#define HEIGHT_RANGE_SD 10
+
+/*Accelerometer readings averaged to measure gravity*/
+#define HEIGHT_CAL_SAMPLES 32
+
+/*Age of the last range after which the height is invalid (us)*/
+#define HEIGHT_STALE_US 250000UL
+
+/********************************************
+ * 		      Function Prototypes           *
+ ********************************************/
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Measures gravity, resets the filter and starts background
+ *    ranging. The accelerometer and ultrasonic drivers must be
+ *    initialized first and the drill must not be moving. Takes
+ *    about HEIGHT_CAL_SAMPLES * 10ms. Returns false if the
+ *    accelerometer could not be read.
+ *
+ **************************************************************/
+bool init_height_estimator(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Reads the accelerometer, advances the filter to the present
+ *    and corrects it with any new ranges. Should be called from
+ *    the application loop at the accelerometer data rate (every
+ *    10ms). Returns false if the accelerometer could not be read,
+ *    in which case zero acceleration is assumed.
+ *
+ **************************************************************/
+bool update_height(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the estimated height above ground in mm at the last
+ *    update.
+ *
+ **************************************************************/
+int16_t get_height_mm(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the estimated vertical velocity in mm/s at the last
+ *    update, positive upwards.
+ *
+ **************************************************************/
+int16_t get_vert_speed(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns true if a range has been accepted within the last
+ *    HEIGHT_STALE_US, so the height is not accelerometer alone.
+ *
+ **************************************************************/
+bool height_valid(void);
+
+#endif
+/* End of height.h */
@@ -0,0 +1,221 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Implementation of the fixed-point height Kalman filter. See
+ *    height_kf.h for further details.
+ *
+ *    Time steps are converted to seconds in Q16 (at most 16384 for
+ *    HEIGHT_MAX_DT), which keeps every product of a state or
+ *    covariance with a time step within 64 bits.
+ *
+ **************************************************************/
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include "height_kf.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Converts us to seconds in Q16, 2^16/10^6 = 1024/15625*/
+#define US_TO_Q16(us) ((int32_t)(((us) * 1024UL) / 15625UL))
+
+/*Variance limit in Q24.8*/
+#define VAR_MAX (HEIGHT_VAR_MAX << HEIGHT_P_Q)
+
+/*Largest range standard deviation (mm)*/
+#define RANGE_SD_MAX 1000
+
+/*Largest acceleration input (mm/s^2), about 10g*/
+#define ACCEL_MAX 100000L
+
+/*Rounding constant for the Q16.16 to integer conversion*/
+#define HEIGHT_ROUND (1L << (HEIGHT_Q - 1))
+
+/********************************************
+ * 	    Static Function Prototypes          *
+ ********************************************/
+static int32_t mul_q16(int32_t val, int32_t q16);
+static void predict_step(height_kf *kf, int32_t accel, int32_t dt);
+static void restart(height_kf *kf, int32_t range, int32_t r);
+static int32_t isqrt(uint64_t val);
+
+/*Multiply by a Q16 value*/
+static int32_t mul_q16(int32_t val, int32_t q16)
+{
+	return (int32_t)(((int64_t)val * q16) >> 16);
+}
+
+/*Advances the filter by dt seconds (Q16), at most HEIGHT_MAX_DT*/
+static void predict_step(height_kf *kf, int32_t accel, int32_t dt)
+{
+	/*State, the velocity change is already Q16.16*/
+	int32_t dv = accel * dt;
+
+	kf->h += mul_q16(kf->v, dt) + (mul_q16(dv, dt) >> 1);
+	kf->v += dv;
+
+	/*Process noise of a white acceleration input:
+	  q11 = s^2 dt^2, q01 = q11 dt / 2, q00 = q01 dt / 2*/
+	int32_t q11 = (int32_t)(((int64_t)kf->accel_var * dt * dt) >>
+	                        (32 - HEIGHT_P_Q));
+	int32_t q01 = mul_q16(q11, dt) >> 1;
+	int32_t q00 = mul_q16(q01, dt) >> 1;
+
+	/*P = F P F' + Q with F = [1 dt; 0 1]*/
+	int32_t dp = mul_q16(kf->p11, dt);
+	int32_t p00 = kf->p00 + 2 * mul_q16(kf->p01, dt) + mul_q16(dp, dt) + q00;
+	int32_t p01 = kf->p01 + dp + q01;
+	int32_t p11 = kf->p11 + q11;
+
+	/*Limit the variances, then keep p01^2 <= p00 * p11 so that the
+	  covariance matrix stays positive definite*/
+	if((p00 > VAR_MAX) || (p11 > VAR_MAX))
+	{
+		if(p00 > VAR_MAX) p00 = VAR_MAX;
+		if(p11 > VAR_MAX) p11 = VAR_MAX;
+
+		int32_t lim = isqrt((uint64_t)p00 * p11);
+		if(p01 > lim) p01 = lim;
+		if(p01 < -lim) p01 = -lim;
+	}
+
+	kf->p00 = p00;
+	kf->p01 = p01;
+	kf->p11 = p11;
+}
+
+/*Takes a range as the height*/
+static void restart(height_kf *kf, int32_t range, int32_t r)
+{
+	kf->h = range << HEIGHT_Q;
+	kf->p00 = r;
+	kf->p01 = 0;
+	kf->locked = true;
+	kf->rejects = 0;
+}
+
+/*Integer square root, rounded down*/
+static int32_t isqrt(uint64_t val)
+{
+	uint64_t root = 0;
+	uint64_t bit = 1ULL << 62;
+
+	while(bit > val) bit >>= 2;
+
+	while(bit)
+	{
+		if(val >= root + bit)
+		{
+			val -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return (int32_t)root;
+}
+
+/********************************************
+ * 		        API Functions               *
+ ********************************************/
+/*See height_kf.h for details*/
+void init_height_kf(height_kf *kf, uint16_t accel_sd)
+{
+	kf->h = 0;
+	kf->v = 0;
+	kf->p00 = VAR_MAX;
+	kf->p01 = 0;
+	kf->p11 = VAR_MAX;
+	kf->accel_var = (int32_t)accel_sd * accel_sd;
+	kf->locked = false;
+	kf->rejects = 0;
+}
+
+/*See height_kf.h for details*/
+void predict_height_kf(height_kf *kf, int32_t accel, uint32_t dt)
+{
+	/*Nothing to predict before the first range*/
+	if(!kf->locked) return;
+
+	if(accel > ACCEL_MAX) accel = ACCEL_MAX;
+	if(accel < -ACCEL_MAX) accel = -ACCEL_MAX;
+
+	/*Keep the products within range over long gaps*/
+	while(dt > HEIGHT_MAX_DT)
+	{
+		predict_step(kf, accel, US_TO_Q16(HEIGHT_MAX_DT));
+		dt -= HEIGHT_MAX_DT;
+	}
+
+	predict_step(kf, accel, US_TO_Q16(dt));
+}
+
+/*See height_kf.h for details*/
+bool correct_height_kf(height_kf *kf, int32_t range, uint16_t range_sd)
+{
+	if(range_sd > RANGE_SD_MAX) range_sd = RANGE_SD_MAX;
+	if(range_sd == 0) range_sd = 1;
+
+	int32_t r = ((int32_t)range_sd * range_sd) << HEIGHT_P_Q;
+
+	if(!kf->locked)
+	{
+		restart(kf, range, r);
+		return true;
+	}
+
+	int32_t s = kf->p00 + r;
+	int64_t y = ((int64_t)range << HEIGHT_Q) - kf->h;
+
+	/*Innovation gate, y^2 > (n sigma)^2 * s in whole mm*/
+	int64_t y_mm = y >> HEIGHT_Q;
+	if(((y_mm * y_mm) << HEIGHT_P_Q) >
+	   ((int64_t)HEIGHT_GATE_SIGMA * HEIGHT_GATE_SIGMA * s))
+	{
+		if(++kf->rejects < HEIGHT_RELOCK) return false;
+
+		/*The height has really moved*/
+		restart(kf, range, r);
+		return true;
+	}
+	kf->rejects = 0;
+
+	/*Gains in Q16*/
+	int32_t k0 = (int32_t)(((int64_t)kf->p00 << 16) / s);
+	int32_t k1 = (int32_t)(((int64_t)kf->p01 << 16) / s);
+
+	kf->h += (int32_t)((k0 * y) >> 16);
+	kf->v += (int32_t)((k1 * y) >> 16);
+
+	/*P = (I - K H) P with H = [1 0]*/
+	int32_t p01 = kf->p01;
+	kf->p00 -= mul_q16(kf->p00, k0);
+	kf->p01 -= mul_q16(p01, k0);
+	kf->p11 -= mul_q16(p01, k1);
+	if(kf->p00 < 1) kf->p00 = 1;
+	if(kf->p11 < 1) kf->p11 = 1;
+
+	return true;
+}
+
+/*See height_kf.h for details*/
+int32_t get_height_kf(const height_kf *kf)
+{
+	return (kf->h + HEIGHT_ROUND) >> HEIGHT_Q;
+}
+
+/*See height_kf.h for details*/
+int32_t get_height_kf_vel(const height_kf *kf)
+{
+	return (kf->v + HEIGHT_ROUND) >> HEIGHT_Q;
+}
+/* End of height_kf.c */
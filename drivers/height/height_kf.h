@@ -0,0 +1,121 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Fixed-point Kalman filter for height and vertical velocity.
+ *    The state is predicted from measured vertical acceleration,
+ *    treated as a known input with white noise, and corrected by
+ *    range measurements of the height:
+ *
+ *        h = h + v * dt + a * dt^2 / 2
+ *        v = v + a * dt
+ *
+ *    Heights are in mm, velocities in mm/s, accelerations in
+ *    mm/s^2 and time steps in us. The state is held in Q16.16 and
+ *    the covariance in Q24.8. 64-bit integers are used only for
+ *    intermediate products and no floating point is used.
+ *
+ *    A range whose innovation lies outside HEIGHT_GATE_SIGMA
+ *    standard deviations is rejected. HEIGHT_RELOCK rejections in
+ *    a row restart the filter from the next range, so a real jump
+ *    in height is followed rather than ignored. The module does not
+ *    depend on any other driver.
+ *
+ **************************************************************/
+
+#ifndef HEIGHT_KF_H_
+#define HEIGHT_KF_H_
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Fractional bits of the state and the covariance*/
+#define HEIGHT_Q     16
+#define HEIGHT_P_Q   8
+
+/*Innovation gate in standard deviations*/
+#define HEIGHT_GATE_SIGMA 3
+
+/*Consecutive rejected ranges that restart the filter*/
+#define HEIGHT_RELOCK 4
+
+/*Longest prediction step, longer gaps are split (us)*/
+#define HEIGHT_MAX_DT 250000UL
+
+/*Largest height and velocity variance, (mm)^2 and (mm/s)^2*/
+#define HEIGHT_VAR_MAX 1000000L
+
+/********************************************
+ * 		          Structs                   *
+ ********************************************/
+/*Height Filter State*/
+typedef struct {
+	int32_t h;         //Height (Q16.16 mm)
+	int32_t v;         //Vertical velocity (Q16.16 mm/s)
+	int32_t p00;       //Height variance (Q24.8 mm^2)
+	int32_t p01;       //Covariance (Q24.8 mm^2/s)
+	int32_t p11;       //Velocity variance (Q24.8 mm^2/s^2)
+	int32_t accel_var; //Acceleration noise variance (mm/s^2)^2
+	bool locked;       //A range has been accepted
+	uint8_t rejects;   //Consecutive rejected ranges
+}height_kf;
+
+/********************************************
+ * 		      Function Prototypes           *
+ ********************************************/
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Initializes a filter with no height fix. "accel_sd" is the
+ *    standard deviation of the acceleration input in mm/s^2 and
+ *    sets how quickly the filter trusts new ranges over the
+ *    accelerometer.
+ *
+ **************************************************************/
+void init_height_kf(height_kf *kf, uint16_t accel_sd);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Advances the filter by "dt" us with vertical acceleration
+ *    "accel" in mm/s^2, positive upwards.
+ *
+ **************************************************************/
+void predict_height_kf(height_kf *kf, int32_t accel, uint32_t dt);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Corrects the filter with a measured height "range" in mm
+ *    whose standard deviation is "range_sd" mm. The first range
+ *    after initialization or a restart sets the height. Returns
+ *    true if the range was used.
+ *
+ **************************************************************/
+bool correct_height_kf(height_kf *kf, int32_t range, uint16_t range_sd);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the estimated height in mm, rounded.
+ *
+ **************************************************************/
+int32_t get_height_kf(const height_kf *kf);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the estimated vertical velocity in mm/s, rounded.
+ *
+ **************************************************************/
+int32_t get_height_kf_vel(const height_kf *kf);
+
+#endif
+/* End of height_kf.h */
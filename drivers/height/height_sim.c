@@ -0,0 +1,167 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host benchmark for the height Kalman filter. Runs height_kf.c
+ *    with the default height.h noise settings on a simulated
+ *    descent: a hover at 1.5m, a descent at 300mm/s and a landing
+ *    at 200mm. The accelerometer is sampled at 100Hz with noise
+ *    and a residual offset, and sensors A and B are pinged
+ *    alternately every 30ms with noise, timeouts and outliers.
+ *    The error of the filter is compared with using the latest
+ *    range directly.
+ *
+ *    The noise levels below are estimates and should be replaced
+ *    with values measured on the drill.
+ *
+ *      make sim
+ *
+ **************************************************************/
+
+#include "height_kf.h"
+#include "height.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+/*Sensor models*/
+#define ACCEL_NOISE  150.0  //mm/s^2 RMS
+#define ACCEL_OFFSET 40.0   //mm/s^2 left after calibration
+#define RANGE_NOISE  8.0    //mm RMS
+#define PING_PERIOD  30000  //us, sensors alternate
+#define RANGE_DELAY  30000  //us from ping to reading
+#define TIMEOUT_RATE 10     //One ping in n gets no echo
+#define OUTLIER_RATE 25     //One ping in n sees an obstacle
+
+/*Test profile (us, mm, mm/s)*/
+#define STEP_US      10000
+#define RUN_US       8000000L
+#define HOVER_END    2000000L
+#define HOVER_HEIGHT 1500.0
+#define LAND_HEIGHT  200.0
+#define DESCENT      300.0
+
+/*Zero mean unit variance noise*/
+static double noise(void)
+{
+	double sum = 0;
+
+	for(int i = 0; i < 12; i++) sum += (double)rand() / RAND_MAX;
+
+	return sum - 6.0;
+}
+
+/*True height and acceleration at time t*/
+static double height_at(long t, double *accel)
+{
+	double ramp = 0.5;  //s to reach the descent speed
+	double s = (t - HOVER_END) / 1e6;
+	double land = (HOVER_HEIGHT - LAND_HEIGHT) / DESCENT + ramp;
+
+	*accel = 0;
+	if(s <= 0) return HOVER_HEIGHT;
+	if(s < ramp)
+	{
+		*accel = -DESCENT / ramp;
+		return HOVER_HEIGHT - 0.5 * DESCENT / ramp * s * s;
+	}
+	if(s < land - ramp)
+	{
+		return HOVER_HEIGHT - DESCENT * (s - ramp / 2);
+	}
+	if(s < land)
+	{
+		double r = land - s;
+		*accel = DESCENT / ramp;
+		return LAND_HEIGHT + 0.5 * DESCENT / ramp * r * r;
+	}
+	return LAND_HEIGHT;
+}
+
+int main(void)
+{
+	height_kf kf;
+	double sq_kf = 0, sq_raw = 0, sq_vel = 0, max_kf = 0, max_raw = 0;
+	long samples = 0, pings = 0, rejected = 0;
+	double raw = HOVER_HEIGHT;
+	double accel;
+
+	/*Pings waiting for their echo*/
+	double pending = 0;
+	long pending_ping = -1, pending_due = 0;
+
+	srand(1);
+	init_height_kf(&kf, HEIGHT_ACCEL_SD);
+
+	for(long t = 0; t < RUN_US; t += STEP_US)
+	{
+		double h = height_at(t, &accel);
+		double prev;
+		double v = (h - height_at(t - 1000, &prev)) * 1000;
+
+		/*Accelerometer sample*/
+		double a = accel + ACCEL_OFFSET + ACCEL_NOISE * noise();
+		predict_height_kf(&kf, (int32_t)lround(a), STEP_US);
+
+		/*Range of the last ping, read RANGE_DELAY after it*/
+		if((pending_ping >= 0) && (t >= pending_due))
+		{
+			if(pending > 0)
+			{
+				/*As height.c, move the range to the present*/
+				long age_ms = (t - pending_ping) / 1000;
+				int32_t z = (int32_t)lround(pending) +
+				            (get_height_kf_vel(&kf) * age_ms) / 1000;
+
+				if(!correct_height_kf(&kf, z, HEIGHT_RANGE_SD)) rejected++;
+				raw = pending;
+			}
+			pending_ping = -1;
+		}
+
+		/*Pings every PING_PERIOD*/
+		for(long p = t - STEP_US + 1; p <= t; p++)
+		{
+			if((p % PING_PERIOD) == 0)
+			{
+				pings++;
+				pending_ping = p;
+				pending_due = p + RANGE_DELAY;
+				pending = height_at(p, &prev) + RANGE_NOISE * noise();
+				if((pings % TIMEOUT_RATE) == 0) pending = 0;
+				else if((pings % OUTLIER_RATE) == 0) pending *= 0.5;
+			}
+		}
+
+		/*Skip the first ping while the filter locks*/
+		if(t < 100000) continue;
+
+		double e_kf = get_height_kf(&kf) - h;
+		double e_raw = raw - h;
+		double e_vel = get_height_kf_vel(&kf) - v;
+
+		sq_kf += e_kf * e_kf;
+		sq_raw += e_raw * e_raw;
+		sq_vel += e_vel * e_vel;
+		if(fabs(e_kf) > max_kf) max_kf = fabs(e_kf);
+		if(fabs(e_raw) > max_raw) max_raw = fabs(e_raw);
+		samples++;
+	}
+
+	printf("Height estimate over a %.1fs descent, updated every %dms\n",
+	       RUN_US / 1e6, STEP_US / 1000);
+	printf("accel sd %d mm/s^2, range sd %d mm\n\n", HEIGHT_ACCEL_SD,
+	       HEIGHT_RANGE_SD);
+	printf("Kalman filter\n");
+	printf("  height error RMS     : %.1f mm\n", sqrt(sq_kf / samples));
+	printf("  height error max     : %.1f mm\n", max_kf);
+	printf("  velocity error RMS   : %.1f mm/s\n", sqrt(sq_vel / samples));
+	printf("  ranges rejected      : %ld of %ld pings\n", rejected, pings);
+	printf("Latest range\n");
+	printf("  height error RMS     : %.1f mm\n", sqrt(sq_raw / samples));
+	printf("  height error max     : %.1f mm\n", max_raw);
+
+	return 0;
+}
+/* End of height_sim.c */
@@ -0,0 +1,61 @@
+#define F_CPU 8000000UL
+
+#include "height.h"
+#include "accelerometer.h"
+#include "ultrasonic.h"
+#include "lcd_driver.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+
+/*Updates between display refreshes (~0.5 seconds)*/
+#define REFRESH_UPDATES 50
+
+/*From itoa.c*/
+extern char *num_to_str(int i);
+
+int main()
+{
+	uint8_t updates = 0;
+
+	sei();
+
+	initialize_LCD_driver();
+	init_ultrasonic_sensors();
+
+	if(!init_accel() || !init_height_estimator())
+	{
+		lcd_puts("IMU FAIL");
+		while(1);
+	}
+
+	/*Display the height in mm and the vertical speed in mm/s*/
+	while(1)
+	{
+		update_height();
+		_delay_ms(10);
+
+		if(++updates < REFRESH_UPDATES) continue;
+		updates = 0;
+
+		lcd_erase();
+		lcd_puts(num_to_str(get_height_mm()));
+		lcd_goto_xy(1, 0);
+		if(!height_valid())
+		{
+			lcd_puts("NO FIX");
+			continue;
+		}
+
+		/*num_to_str() only handles positive numbers*/
+		int16_t speed = get_vert_speed();
+		if(speed < 0)
+		{
+			lcd_puts("-");
+			speed = -speed;
+		}
+		lcd_puts(num_to_str(speed));
+	}
+
+	return 0;
+}
@@ -0,0 +1,23 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host stand-in for <avr/eeprom.h>, used by the host
+ *    simulations only. EEMEM variables are ordinary variables in
+ *    RAM, so the EEPROM survives for the life of the simulation.
+ *
+ **************************************************************/
+
+#ifndef HOST_EEPROM_H_
+#define HOST_EEPROM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define EEMEM
+
+void eeprom_read_block(void *dst, const void *src, size_t n);
+void eeprom_update_block(const void *src, void *dst, size_t n);
+
+#endif
+/* End of eeprom.h */
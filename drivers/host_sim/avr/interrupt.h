@@ -0,0 +1,21 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host stand-in for <avr/interrupt.h>, used by the host
+ *    simulations only. Interrupt vectors become ordinary functions
+ *    that a simulation calls when the event occurs. Interrupts are
+ *    never masked on the host.
+ *
+ **************************************************************/
+
+#ifndef HOST_INTERRUPT_H_
+#define HOST_INTERRUPT_H_
+
+#define ISR(vector) void vector(void)
+
+#define sei() ((void)0)
+#define cli() ((void)0)
+
+#endif
+/* End of interrupt.h */
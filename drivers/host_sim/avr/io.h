@@ -0,0 +1,48 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host stand-in for <avr/io.h>, used by the host simulations
+ *    only. The I/O registers used by the drivers are ordinary
+ *    variables defined in host_sim.c. Bit positions are defined by
+ *    the drivers themselves, as on the AVR build.
+ *
+ *    Nothing behaves like hardware by itself: a simulation moves
+ *    the timers, drives the input pins and calls the interrupt
+ *    vectors. Interrupt flags written by a driver to clear them
+ *    are left set, so simulations clear the TIFRn registers after
+ *    each step.
+ *
+ **************************************************************/
+
+#ifndef HOST_IO_H_
+#define HOST_IO_H_
+
+#include <stdint.h>
+
+/*Registers available to the drivers*/
+#define HOST_REGISTERS(REG8, REG16) \
+	REG8(PINA) REG8(PINB) REG8(PINC) REG8(PIND) \
+	REG8(DDRA) REG8(DDRB) REG8(DDRC) REG8(DDRD) \
+	REG8(PORTA) REG8(PORTB) REG8(PORTC) REG8(PORTD) \
+	REG8(TCCR0A) REG8(TCCR0B) REG8(TCNT0) REG8(OCR0A) REG8(OCR0B) \
+	REG8(TIMSK0) REG8(TIFR0) \
+	REG8(TCCR1A) REG8(TCCR1B) REG8(TCCR1C) REG16(TCNT1) REG16(ICR1) \
+	REG16(OCR1A) REG16(OCR1B) REG8(TIMSK1) REG8(TIFR1) \
+	REG8(TCCR2A) REG8(TCCR2B) REG8(TCNT2) REG8(OCR2A) REG8(OCR2B) \
+	REG8(TIMSK2) REG8(TIFR2) \
+	REG8(TCCR3A) REG8(TCCR3B) REG16(TCNT3) REG16(ICR3) \
+	REG16(OCR3A) REG16(OCR3B) REG8(TIMSK3) REG8(TIFR3) \
+	REG8(PCICR) REG8(PCIFR) \
+	REG8(PCMSK0) REG8(PCMSK1) REG8(PCMSK2) REG8(PCMSK3) \
+	REG8(ADMUX) REG8(ADCSRA) REG8(ADCSRB) REG16(ADC) REG8(ADCL) REG8(ADCH) \
+	REG8(DIDR0) REG8(DIDR1) REG8(ACSR) \
+	REG8(TWBR) REG8(TWSR) REG8(TWCR) REG8(TWDR) \
+	REG8(EECR) REG8(SREG)
+
+#define HOST_EXTERN8(r) extern volatile uint8_t r;
+#define HOST_EXTERN16(r) extern volatile uint16_t r;
+HOST_REGISTERS(HOST_EXTERN8, HOST_EXTERN16)
+
+#endif
+/* End of io.h */
@@ -0,0 +1,30 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host stand-ins for the avr-libc functions used by the driver
+ *    code, so that drivers can be linked into the host
+ *    simulations (make sim). Never built for the AVR.
+ *
+ **************************************************************/
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include <string.h>
+
+/*I/O registers*/
+#define HOST_DEFINE8(r) volatile uint8_t r;
+#define HOST_DEFINE16(r) volatile uint16_t r;
+HOST_REGISTERS(HOST_DEFINE8, HOST_DEFINE16)
+
+/*EEPROM variables live in RAM on the host*/
+void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+	memcpy(dst, src, n);
+}
+
+void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+	memcpy(dst, src, n);
+}
+/* End of host_sim.c */
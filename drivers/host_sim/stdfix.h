@@ -0,0 +1,17 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host stand-in for <stdfix.h>, used by the host simulations
+ *    only. The host compiler has no fixed point types, so accum
+ *    values are held in floats.
+ *
+ **************************************************************/
+
+#ifndef HOST_STDFIX_H_
+#define HOST_STDFIX_H_
+
+#define accum float
+
+#endif
+/* End of stdfix.h */
@@ -0,0 +1,20 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host stand-in for <util/atomic.h>, used by the host
+ *    simulations only. Interrupts only run when a simulation
+ *    calls them, so an atomic block is an ordinary block.
+ *
+ **************************************************************/
+
+#ifndef HOST_ATOMIC_H_
+#define HOST_ATOMIC_H_
+
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_FORCEON      0
+
+#define ATOMIC_BLOCK(type) for(int host_atomic_ = 1; host_atomic_; host_atomic_ = 0)
+
+#endif
+/* End of atomic.h */
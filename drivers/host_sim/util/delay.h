@@ -0,0 +1,18 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host stand-in for <util/delay.h>, used by the host
+ *    simulations only. Delays return at once, simulated time only
+ *    moves when the simulation advances it.
+ *
+ **************************************************************/
+
+#ifndef HOST_DELAY_H_
+#define HOST_DELAY_H_
+
+static inline void _delay_ms(double ms) { (void)ms; }
+static inline void _delay_us(double us) { (void)us; }
+
+#endif
+/* End of delay.h */
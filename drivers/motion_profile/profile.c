@@ -0,0 +1,202 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Implementation of the jerk-limited trapezoidal motion
+ *    profile generator. See profile.h for further details.
+ *
+ *    Each tick the generator works in the direction of the target
+ *    and chooses a desired acceleration: full deceleration once the
+ *    remaining distance is within the stopping distance, zero when
+ *    the velocity is about to reach its limit, and full acceleration
+ *    otherwise. The actual acceleration slews toward the desired
+ *    value at the jerk limit.
+ *
+ **************************************************************/
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include "profile.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Longest braking plan replayed by stopping_distance() (ticks)*/
+#define MAX_STOP_TICKS 255
+
+/********************************************
+ * 	    Static Function Prototypes          *
+ ********************************************/
+static int32_t slew_acc(const motion_profile *prof, int32_t a, int32_t a_des);
+static uint32_t stopping_distance(const motion_profile *prof,
+                                  int32_t v, int32_t a);
+
+/*Move acceleration toward a desired value at the jerk limit*/
+static int32_t slew_acc(const motion_profile *prof, int32_t a, int32_t a_des)
+{
+	if((a_des - a) > (int32_t)prof->j_max) return a + prof->j_max;
+	if((a - a_des) > (int32_t)prof->j_max) return a - prof->j_max;
+	return a_des;
+}
+
+/*Distance (Q24.8) covered braking from velocity v and acceleration a.
+  Replays the braking update tick by tick so the result matches the
+  discrete profile exactly.*/
+static uint32_t stopping_distance(const motion_profile *prof,
+                                  int32_t v, int32_t a)
+{
+	uint32_t dist = 0;
+	uint8_t ticks = MAX_STOP_TICKS;
+
+	while(ticks--)
+	{
+		a = slew_acc(prof, a, -(int32_t)prof->a_max);
+		v += a;
+		if(v <= 0) break;
+		dist += v;
+	}
+
+	return dist;
+}
+
+/********************************************
+ * 		        API Functions               *
+ ********************************************/
+/*See profile.h for details*/
+void init_profile(motion_profile *prof, int32_t pos)
+{
+	prof->pos = pos << PROFILE_Q;
+	prof->target = prof->pos;
+	prof->vel = 0;
+	prof->acc = 0;
+	prof->done = true;
+	set_profile_limits(prof, prof->v_max, prof->a_max, prof->j_max);
+}
+
+/*See profile.h for details*/
+void set_profile_limits(motion_profile *prof, uint16_t v_max,
+                        uint16_t a_max, uint16_t j_max)
+{
+	prof->v_max = v_max ? v_max : 1;
+	prof->a_max = a_max ? a_max : 1;
+	prof->j_max = j_max ? j_max : 1;
+}
+
+/*See profile.h for details*/
+void start_profile(motion_profile *prof, int32_t target)
+{
+	prof->target = target << PROFILE_Q;
+	prof->done = (prof->target == prof->pos) && (prof->vel == 0);
+}
+
+/*See profile.h for details*/
+int32_t update_profile(motion_profile *prof)
+{
+	if(prof->done) return prof->pos >> PROFILE_Q;
+
+	int32_t dist = prof->target - prof->pos;
+	int8_t dir = (dist >= 0) ? 1 : -1;
+	uint32_t remain = (uint32_t)(dist * dir);
+
+	/*Velocity and acceleration toward the target*/
+	int32_t v = prof->vel * dir;
+	int32_t a = prof->acc * dir;
+	int32_t v_max = prof->v_max;
+	int32_t a_max = prof->a_max;
+	int32_t a_des;
+
+	/*Choose an acceleration ignoring the target*/
+	if(v > v_max)
+	{
+		/*Limit was lowered during the move, ramp the deceleration
+		  out to arrive at the new limit*/
+		if((a < 0) && ((uint32_t)(v - v_max) <= (((uint32_t)a * (uint32_t)a) /
+		   (2UL * prof->j_max))))
+		{
+			a_des = 0;
+		}
+		else
+		{
+			a_des = -a_max;
+		}
+	}
+	else if((a > 0) && (v > 0) && ((uint32_t)v + (((uint32_t)a * (uint32_t)a) /
+	        (2UL * prof->j_max)) >= (uint32_t)v_max))
+	{
+		/*Ramp acceleration out to arrive at the velocity limit*/
+		a_des = 0;
+	}
+	else if(v == v_max)
+	{
+		a_des = 0;
+	}
+	else
+	{
+		a_des = a_max;
+	}
+
+	int32_t a_next = slew_acc(prof, a, a_des);
+	int32_t v_next = v + a_next;
+
+	/*Hold the velocity limit while cruising*/
+	if((a_des >= 0) && (v <= v_max) && (v_next > v_max))
+	{
+		v_next = v_max;
+		a_next = 0;
+	}
+
+	/*Brake now if the target could not be reached at rest after
+	  another tick of this acceleration. A negative velocity (moving
+	  away after a target change) is already being braked above.*/
+	if((v_next > 0) &&
+	   ((uint32_t)v_next + stopping_distance(prof, v_next, a_next) > remain))
+	{
+		a_next = slew_acc(prof, a, -a_max);
+		v_next = v + a_next;
+
+		/*Braking finished short of the target, creep the rest*/
+		if((v >= 0) && (v_next <= 0))
+		{
+			v_next = ((int32_t)remain < a_max) ? (int32_t)remain : a_max;
+			a_next = 0;
+		}
+	}
+
+	/*Arrive on the target*/
+	if((v_next > 0) && ((uint32_t)v_next >= remain))
+	{
+		prof->pos = prof->target;
+		prof->vel = 0;
+		prof->acc = 0;
+		prof->done = true;
+		return prof->pos >> PROFILE_Q;
+	}
+
+	prof->vel = v_next * dir;
+	prof->acc = a_next * dir;
+	prof->pos += prof->vel;
+
+	return prof->pos >> PROFILE_Q;
+}
+
+/*See profile.h for details*/
+int32_t get_profile_position(const motion_profile *prof)
+{
+	return prof->pos >> PROFILE_Q;
+}
+
+/*See profile.h for details*/
+int16_t get_profile_velocity(const motion_profile *prof)
+{
+	return (int16_t)(prof->vel >> PROFILE_Q);
+}
+
+/*See profile.h for details*/
+bool profile_done(const motion_profile *prof)
+{
+	return prof->done;
+}
+/* End of profile.c */
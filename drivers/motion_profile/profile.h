@@ -0,0 +1,118 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Jerk-limited trapezoidal motion profile generator. Given a
+ *    target position and velocity, acceleration and jerk limits,
+ *    the generator produces one position setpoint per tick that
+ *    accelerates, cruises and decelerates onto the target with
+ *    zero velocity. The profile is computed online, so the target
+ *    and the limits may be changed while a move is in progress.
+ *
+ *    Positions are in encoder counts and time is in ticks (one
+ *    encoder velocity window). Internally all values are Q24.8
+ *    fixed-point and no floating point is used.
+ *
+ **************************************************************/
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Fractional bits of the profile values*/
+#define PROFILE_Q 8
+
+/*Converts a whole number limit to Q8.8*/
+#define PROFILE_LIMIT(x) ((uint16_t)((x) * (1 << PROFILE_Q)))
+
+/********************************************
+ * 		          Structs                   *
+ ********************************************/
+/*Motion Profile State*/
+typedef struct {
+	int32_t pos;    //Setpoint position (Q24.8 counts)
+	int32_t vel;    //Setpoint velocity (Q24.8 counts/tick)
+	int32_t acc;    //Setpoint acceleration (Q24.8 counts/tick^2)
+	int32_t target; //Target position (Q24.8 counts)
+	uint16_t v_max; //Velocity limit (Q8.8 counts/tick)
+	uint16_t a_max; //Acceleration limit (Q8.8 counts/tick^2)
+	uint16_t j_max; //Jerk limit (Q8.8 counts/tick^3)
+	bool done;      //Setpoint has reached the target
+}motion_profile;
+
+/********************************************
+ * 		      Function Prototypes           *
+ ********************************************/
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Initializes a profile at rest at position "pos" (counts).
+ *
+ **************************************************************/
+void init_profile(motion_profile *prof, int32_t pos);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Sets the velocity, acceleration and jerk limits of a profile.
+ *    Limits are Q8.8 values, see PROFILE_LIMIT(). Zero limits are
+ *    raised to the smallest representable value.
+ *
+ **************************************************************/
+void set_profile_limits(motion_profile *prof, uint16_t v_max,
+                        uint16_t a_max, uint16_t j_max);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Starts a move to "target" (counts) from the current setpoint
+ *    and velocity.
+ *
+ **************************************************************/
+void start_profile(motion_profile *prof, int32_t target);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Advances the profile one tick and returns the new position
+ *    setpoint in counts.
+ *
+ **************************************************************/
+int32_t update_profile(motion_profile *prof);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the position setpoint in whole counts.
+ *
+ **************************************************************/
+int32_t get_profile_position(const motion_profile *prof);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the velocity setpoint in whole counts per tick. Used
+ *    as a feedforward term by position loops.
+ *
+ **************************************************************/
+int16_t get_profile_velocity(const motion_profile *prof);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns true once the setpoint has reached the target.
+ *
+ **************************************************************/
+bool profile_done(const motion_profile *prof);
+
+#endif
+/* End of profile.h */
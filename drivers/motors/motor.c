@@ -2,24 +2,44 @@
  * Nicholas Shanahan (2016)
  *
  * DESCRIPTION:
- *  - Driver for Pololu High-Power Motor Driver 18v25 (hardware). 
+ *  - Driver for Pololu High-Power Motor Driver 18v25 (hardware).
  *    Provides directional control of DC brushed motors. This API
  *    utilizes the 8-bit Timer/Counter2 hardware internal to AVR
  *    microcontrollers to provide a pulse-width modulated (PWM)
  *    signal the hardware motor driver.
  *
+ *    The Timer2 overflow interrupt runs a ramp layer at ~1kHz
+ *    that slews each motor's duty cycle toward its requested
+ *    value. Direction changes are sequenced by the ramp layer:
+ *    ramp down to the safety floor, disable the output for a
+ *    dead time, flip the DIR pin, and ramp back up.
+ *
+ *    Stops are also timed by the ramp layer. Depending on the stop
+ *    mode of the motor the driver is put to sleep (coast), its PWM
+ *    input is held low (dynamic braking), or the motor is briefly
+ *    driven in reverse before dynamic braking (plug braking).
+ *
  **************************************************************/
 
 /********************************************
  * 		          Includes                  *
- ********************************************/ 
+ ********************************************/
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include "motor.h"
+#include "adc.h"
 
 /********************************************
  * 		           Macros                   *
  ********************************************/
+/*Processor Frequency*/
+#ifndef F_CPU
+#define F_CPU 8000000UL
+#endif
+
 /*Concatentation Macros*/
 #define CONCAT(A,B) A##B
 #define DDR(letter) CONCAT(DDR,letter)
@@ -36,14 +56,382 @@
 /*TCCR2B Control Bits*/
 #define CS22 2
 #define CS21 1
-#define CS20 0   
+#define CS20 0
+
+/*Timer2 Interrupt Mask Register Bits*/
+#define TOIE2 0
+
+/*ACSR Analog Comparator Bits*/
+#define ACD   7
+#define ACBG  6
+#define ACO   5
+#define ACI   4
+#define ACIE  3
+#define ACIC  2
+#define ACIS1 1
+#define ACIS0 0
+
+/*ADCSRB Analog Comparator Multiplexer Enable*/
+#define ACME 6
+
+/*DIDR1 Digital Input Disable Bits*/
+#define AIN1D 1
+#define AIN0D 0
+
+/*PWM output enable bits of both motors*/
+#define COM2_MASK ((1 << COM2A1) | (1 << COM2A0) | (1 << COM2B1) | (1 << COM2B0))
 
 /*Mask to clear registers*/
 #define CLEAR 0x00
 
-/*Minimum PWM value allowable by motors*/
-#define TRANS_SAFETY_PWM 50//77  // ~30% --> 3.6V
-#define ROTAT_SAFETY_PWM 50//140 // ~55% --> 6.6V
+/*Timer2 clock select field*/
+#define CS2_MASK ((1 << CS22) | (1 << CS21) | (1 << CS20))
+
+/*Timer2 counts per PWM period (TOP = 0xFF)*/
+#define FAST_PWM_PERIOD  256UL
+#define PHASE_PWM_PERIOD 510UL
+
+/*PWM frequency the safety floors in motor.h were chosen at*/
+#define REF_PWM_FREQ (F_CPU / (8UL * FAST_PWM_PERIOD))
+
+/*Ramp layer tick rate*/
+#define RAMP_TICK_HZ 1000UL
+
+/*Ramp phases*/
+#define RAMP_OFF  0 //Output disabled
+#define RAMP_RUN  1 //Slewing toward the target duty
+#define RAMP_DOWN 2 //Slewing down before a direction change
+#define RAMP_DEAD 3 //Output disabled before flipping DIR
+#define RAMP_PLUG 4 //Reverse drive of a plug brake
+#define RAMP_STOP 5 //Stopping, output disabled
+
+/********************************************
+ * 		          Structs                   *
+ ********************************************/
+/*Ramp state of one motor*/
+typedef struct {
+	uint8_t floor;   //Lowest duty allowed while driving
+	uint8_t target;  //Requested duty
+	uint8_t duty;    //Duty currently applied
+	bool dir;        //Requested DIR pin level
+	uint8_t phase;   //One of the RAMP_* phases
+	uint8_t ticks;   //Ticks remaining in a timed phase
+}motor_ramp;
+
+/********************************************
+ * 	          Global Variables              *
+ ********************************************/
+/*Ramp state, shared with the Timer2 overflow ISR*/
+static volatile motor_ramp ramp[2] = {
+	[ROTAT_MOTOR] = {ROTAT_SAFETY_PWM, ROTAT_SAFETY_PWM, 0, false, RAMP_OFF, 0},
+	[TRANS_MOTOR] = {TRANS_SAFETY_PWM, TRANS_SAFETY_PWM, 0, false, RAMP_OFF, 0},
+};
+
+/*Stop mode of each motor*/
+static motor_stop_mode stop_mode[2] = {MOTOR_STOP_BRAKE, MOTOR_STOP_BRAKE};
+
+/*Overcurrent fault latched by the comparator ISR*/
+static volatile bool motor_fault = false;
+
+/*Duty change per ramp tick (0 applies changes at once)*/
+static volatile uint8_t ramp_rate = MOTOR_RAMP_RATE;
+
+/*Overflows per ramp tick and overflows remaining until the next*/
+static uint8_t ramp_div_reload = 1;
+static uint8_t ramp_div = 1;
+
+/*Active PWM configuration*/
+static motor_pwm_mode pwm_mode = MOTOR_FAST_PWM;
+static motor_prescaler pwm_prescaler = MOTOR_PRESCALE_8;
+
+/*Timer2 prescaler divisors indexed by clock select value*/
+static const uint16_t prescaler_div[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+
+/********************************************
+ * 	    Static Function Prototypes          *
+ ********************************************/
+static void write_duty(motor_id id, uint8_t duty);
+static void enable_output(motor_id id);
+static void disable_output(motor_id id);
+static void write_dir(motor_id id, bool level);
+static void write_reset(motor_id id, bool level);
+static void request_direction(motor_id id, bool level);
+static void brake_motor(motor_id id);
+static void ramp_motor(motor_id id);
+static inline void trip_motors(void);
+static uint32_t pwm_freq(motor_pwm_mode mode, motor_prescaler ps);
+static uint8_t scale_floor(uint8_t ref, uint32_t freq, motor_pwm_mode mode);
+
+/*PWM frequency produced by a mode and prescaler*/
+static uint32_t pwm_freq(motor_pwm_mode mode, motor_prescaler ps)
+{
+	uint32_t period = (mode == MOTOR_FAST_PWM) ? FAST_PWM_PERIOD : PHASE_PWM_PERIOD;
+	return F_CPU / (prescaler_div[ps] * period);
+}
+
+/*Convert a safety floor chosen at the reference Fast PWM frequency
+  to a compare value giving the same effective duty cycle*/
+static uint8_t scale_floor(uint8_t ref, uint32_t freq, motor_pwm_mode mode)
+{
+	/*Reference duty as a 0.16 fraction of the period*/
+	int32_t frac = ((int32_t)ref + 1) << 8;
+	/*Extra on-time lost to switching at the new frequency (ppm)*/
+	int32_t loss_ppm = ((int32_t)MOTOR_SWITCH_LOSS_NS *
+	                    ((int32_t)freq - (int32_t)REF_PWM_FREQ)) / 1000L;
+	frac += (loss_ppm * 4096L) / 62500L;
+
+	/*Fast PWM duty is (OCR + 1)/256, phase correct duty is OCR/255*/
+	int32_t ocr = (mode == MOTOR_FAST_PWM) ? (((frac + 255L) >> 8) - 1) :
+	                                         (((frac * 255L) + 65535L) >> 16);
+
+	if(ocr < 0) return 0;
+	if(ocr > MOTOR_MAX_PWM) return MOTOR_MAX_PWM;
+	return (uint8_t)ocr;
+}
+
+/*Write the compare register of a motor*/
+static void write_duty(motor_id id, uint8_t duty)
+{
+	if(id == ROTAT_MOTOR) OCR2A = duty;
+	else OCR2B = duty;
+}
+
+/*Enable Clear on Compare Match mode for a motor*/
+static void enable_output(motor_id id)
+{
+	if(motor_fault) return;
+	if(id == ROTAT_MOTOR) TCCR2A |= (1 << COM2A1);
+	else TCCR2A |= (1 << COM2B1);
+}
+
+/*Disconnect the PWM output of a motor*/
+static void disable_output(motor_id id)
+{
+	if(id == ROTAT_MOTOR) TCCR2A &= ~((1 << COM2A1) | (1 << COM2A0));
+	else TCCR2A &= ~((1 << COM2B1) | (1 << COM2B0));
+}
+
+/*Set the DIR pin of a motor*/
+static void write_dir(motor_id id, bool level)
+{
+	if(id == ROTAT_MOTOR)
+	{
+		if(level) PORT(ROTAT_MOTOR_DIR_PORT) |= (1 << ROTAT_MOTOR_DIR_POS);
+		else PORT(ROTAT_MOTOR_DIR_PORT) &= ~(1 << ROTAT_MOTOR_DIR_POS);
+	}
+	else
+	{
+		if(level) PORT(TRANS_MOTOR_DIR_PORT) |= (1 << TRANS_MOTOR_DIR_POS);
+		else PORT(TRANS_MOTOR_DIR_PORT) &= ~(1 << TRANS_MOTOR_DIR_POS);
+	}
+}
+
+/*Set the RESET pin of a motor driver, low puts it to sleep*/
+static void write_reset(motor_id id, bool level)
+{
+	if(id == ROTAT_MOTOR)
+	{
+		if(level) PORT(ROTAT_MOTOR_RESET_PORT) |= (1 << ROTAT_MOTOR_RESET_POS);
+		else PORT(ROTAT_MOTOR_RESET_PORT) &= ~(1 << ROTAT_MOTOR_RESET_POS);
+	}
+	else
+	{
+		if(level) PORT(TRANS_MOTOR_RESET_PORT) |= (1 << TRANS_MOTOR_RESET_POS);
+		else PORT(TRANS_MOTOR_RESET_PORT) &= ~(1 << TRANS_MOTOR_RESET_POS);
+	}
+}
+
+/*Drive a motor in the direction given by the DIR pin level*/
+static void request_direction(motor_id id, bool level)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		volatile motor_ramp *m = &ramp[id];
+
+		if(motor_fault)
+		{
+			/*Stay braked until the fault is cleared*/
+		}
+		else if((m->phase == RAMP_OFF) || (m->phase == RAMP_STOP) ||
+		        (m->phase == RAMP_PLUG))
+		{
+			/*Start from the safety floor in the new direction, a stop
+			  in progress is abandoned*/
+			m->dir = level;
+			m->duty = m->floor;
+			m->phase = RAMP_RUN;
+			write_reset(id, true);
+			write_dir(id, level);
+			write_duty(id, m->duty);
+			enable_output(id);
+		}
+		else if(m->dir != level)
+		{
+			/*Reverse through ramp down and dead time, or cancel a
+			  reversal that has not reached the dead time yet*/
+			m->dir = level;
+			if(m->phase == RAMP_RUN) m->phase = RAMP_DOWN;
+			else if(m->phase == RAMP_DOWN) m->phase = RAMP_RUN;
+		}
+	}
+}
+
+/*Start stopping a motor in its stop mode*/
+static void brake_motor(motor_id id)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		volatile motor_ramp *m = &ramp[id];
+
+		/*A stop in progress runs to completion*/
+		if((m->phase == RAMP_STOP) || (m->phase == RAMP_PLUG)) return;
+
+		bool driven = (m->phase == RAMP_RUN) || (m->phase == RAMP_DOWN);
+		/*DIR level the motor is actually turning with*/
+		bool turning = (m->phase == RAMP_DOWN) ? !m->dir : m->dir;
+
+		/*Disable PWM to stop motors*/
+		disable_output(id);
+		m->duty = 0;
+
+		if(!driven)
+		{
+			/*Not moving under power, hold it braked*/
+			m->phase = RAMP_OFF;
+			m->dir = false;
+			write_dir(id, false);
+		}
+		else if(stop_mode[id] == MOTOR_STOP_PLUG)
+		{
+			/*Reverse after the dead time, see ramp_motor()*/
+			m->dir = !turning;
+			m->ticks = MOTOR_DEAD_TIME + MOTOR_PLUG_TIME;
+			m->phase = RAMP_PLUG;
+		}
+		else if(stop_mode[id] == MOTOR_STOP_COAST)
+		{
+			write_reset(id, false);
+			m->ticks = MOTOR_COAST_TIME;
+			m->phase = RAMP_STOP;
+		}
+		else
+		{
+			m->ticks = MOTOR_BRAKE_TIME;
+			m->phase = RAMP_STOP;
+		}
+	}
+}
+
+/*Cut both PWM outputs before anything else and latch the fault*/
+static inline void trip_motors(void)
+{
+	TCCR2A &= ~COM2_MASK;
+	motor_fault = true;
+
+	/*Keep the ramp layer from re-enabling the outputs*/
+	ramp[ROTAT_MOTOR].phase = RAMP_OFF;
+	ramp[ROTAT_MOTOR].duty = 0;
+	ramp[TRANS_MOTOR].phase = RAMP_OFF;
+	ramp[TRANS_MOTOR].duty = 0;
+}
+
+/*Advance the ramp of one motor by one tick*/
+static void ramp_motor(motor_id id)
+{
+	volatile motor_ramp *m = &ramp[id];
+	uint8_t duty = m->duty;
+	uint8_t rate = ramp_rate;
+
+	switch(m->phase)
+	{
+		case RAMP_RUN:
+			if(duty == m->target) return;
+			if(rate == 0) duty = m->target;
+			else if(duty < m->target)
+			{
+				duty = ((uint8_t)(m->target - duty) > rate) ? (duty + rate) : m->target;
+			}
+			else
+			{
+				duty = ((uint8_t)(duty - m->target) > rate) ? (duty - rate) : m->target;
+			}
+			break;
+
+		case RAMP_DOWN:
+			if((rate == 0) || ((uint8_t)(duty - m->floor) <= rate))
+			{
+				/*Floor reached, disable output for the dead time*/
+				disable_output(id);
+				m->ticks = MOTOR_DEAD_TIME;
+				m->phase = RAMP_DEAD;
+				return;
+			}
+			duty -= rate;
+			break;
+
+		case RAMP_DEAD:
+			if(m->ticks && --m->ticks) return;
+			/*Flip direction and start again from the floor*/
+			write_dir(id, m->dir);
+			duty = m->floor;
+			write_duty(id, duty);
+			enable_output(id);
+			m->duty = duty;
+			m->phase = RAMP_RUN;
+			return;
+
+		case RAMP_PLUG:
+			if(m->ticks == MOTOR_PLUG_TIME)
+			{
+				/*Dead time over, drive against the motion*/
+				write_dir(id, m->dir);
+				write_duty(id, MOTOR_PLUG_DUTY);
+				enable_output(id);
+			}
+			if(m->ticks && --m->ticks) return;
+			/*Finish with dynamic braking*/
+			disable_output(id);
+			m->ticks = MOTOR_BRAKE_TIME;
+			m->phase = RAMP_STOP;
+			return;
+
+		case RAMP_STOP:
+			if(m->ticks && --m->ticks) return;
+			/*Stop complete, hold the motor braked*/
+			write_reset(id, true);
+			m->dir = false;
+			write_dir(id, false);
+			m->phase = RAMP_OFF;
+			return;
+
+		default:
+			return;
+	}
+
+	m->duty = duty;
+	write_duty(id, duty);
+}
+
+/********************************************
+ * 	     Interrupt Service Routines         *
+ ********************************************/
+#ifdef MOTOR_OVERCURRENT_TRIP
+/*Overcurrent trip*/
+ISR(ANALOG_COMP_vect)
+{
+	trip_motors();
+}
+#endif
+
+/*Ramp layer tick*/
+ISR(TIMER2_OVF_vect)
+{
+	if(--ramp_div) return;
+	ramp_div = ramp_div_reload;
+
+	ramp_motor(ROTAT_MOTOR);
+	ramp_motor(TRANS_MOTOR);
+}
 
 /********************************************
  * 		        API Functions               *
@@ -51,16 +439,231 @@
 /*See motor.h for additional details*/
 void init_motor_drivers(void)
 {
+	init_motor_drivers_freq(MOTOR_PWM_FREQ);
+}
+
+/*See motor.h for additional details*/
+void init_motor_drivers_freq(uint32_t freq)
+{
+	motor_pwm_mode best_mode = MOTOR_PHASE_CORRECT_PWM;
+	motor_prescaler best_ps = MOTOR_PRESCALE_1;
+	uint32_t best_err = UINT32_MAX;
+
+	/*Search every mode and prescaler for the closest frequency*/
+	for(uint8_t m = MOTOR_FAST_PWM; m <= MOTOR_PHASE_CORRECT_PWM; m++)
+	{
+		for(uint8_t ps = MOTOR_PRESCALE_1; ps <= MOTOR_PRESCALE_1024; ps++)
+		{
+			uint32_t f = pwm_freq((motor_pwm_mode)m, (motor_prescaler)ps);
+			uint32_t err = (f > freq) ? (f - freq) : (freq - f);
+
+			if(err < best_err)
+			{
+				best_err = err;
+				best_mode = (motor_pwm_mode)m;
+				best_ps = (motor_prescaler)ps;
+			}
+		}
+	}
+
+	init_motor_drivers_pwm(best_mode, best_ps);
+}
+
+/*See motor.h for additional details*/
+void init_motor_drivers_pwm(motor_pwm_mode mode, motor_prescaler ps)
+{
+	sei();
 	/*Setup rotational motor output ports*/
 	DDR(ROTAT_MOTOR_PWM_PORT) |= (1 << ROTAT_MOTOR_PWM_POS);
 	DDR(ROTAT_MOTOR_DIR_PORT) |= (1 << ROTAT_MOTOR_DIR_POS);
 	/*Setup translational motor output ports*/
 	DDR(TRANS_MOTOR_PWM_PORT) |= (1 << TRANS_MOTOR_PWM_POS);
 	DDR(TRANS_MOTOR_DIR_PORT) |= (1 << TRANS_MOTOR_DIR_POS);
-	/*Enable Fast PWM mode w/ TOP as 0xFF*/
-	TCCR2A = ((TCCR2A & CLEAR) | (1 << WGM21) | (1 << WGM20));
-	/*Enable divide by 8 prescaler to reduce switching frequency*/
-	TCCR2B = ((TCCR2B & CLEAR) | (1 << CS21));
+	/*Driver RESET outputs, drivers awake*/
+	DDR(ROTAT_MOTOR_RESET_PORT) |= (1 << ROTAT_MOTOR_RESET_POS);
+	DDR(TRANS_MOTOR_RESET_PORT) |= (1 << TRANS_MOTOR_RESET_POS);
+	write_reset(ROTAT_MOTOR, true);
+	write_reset(TRANS_MOTOR, true);
+
+	pwm_mode = mode;
+	pwm_prescaler = ps;
+	uint32_t freq = pwm_freq(mode, ps);
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		/*Rescale the safety floors to the new mode and frequency*/
+		ramp[ROTAT_MOTOR].floor = scale_floor(ROTAT_SAFETY_PWM, freq, mode);
+		ramp[TRANS_MOTOR].floor = scale_floor(TRANS_SAFETY_PWM, freq, mode);
+		ramp[ROTAT_MOTOR].target = ramp[ROTAT_MOTOR].floor;
+		ramp[TRANS_MOTOR].target = ramp[TRANS_MOTOR].floor;
+
+		/*Timer2 overflows once per period in either mode*/
+		uint32_t div = (freq + (RAMP_TICK_HZ / 2)) / RAMP_TICK_HZ;
+		ramp_div_reload = (div == 0) ? 1 : ((div > UINT8_MAX) ? UINT8_MAX : div);
+		ramp_div = ramp_div_reload;
+	}
+
+	/*Fast PWM (mode 3) or phase correct PWM (mode 1), TOP as 0xFF*/
+	if(mode == MOTOR_FAST_PWM)
+	{
+		TCCR2A = ((TCCR2A & CLEAR) | (1 << WGM21) | (1 << WGM20));
+	}
+	else
+	{
+		TCCR2A = ((TCCR2A & CLEAR) | (1 << WGM20));
+	}
+	/*Start the timer with the selected prescaler*/
+	TCCR2B = ((TCCR2B & CLEAR) | (ps & CS2_MASK));
+	/*Enable the ramp layer tick*/
+	TIMSK2 |= (1 << TOIE2);
+}
+
+/*See motor.h for additional details*/
+uint32_t get_motor_pwm_freq(void)
+{
+	return pwm_freq(pwm_mode, pwm_prescaler);
+}
+
+/*See motor.h for additional details*/
+uint8_t get_motor_safety_pwm(motor_id id)
+{
+	return ramp[id].floor;
+}
+
+/*See motor.h for additional details*/
+void set_motor_ramp_rate(uint8_t rate)
+{
+	ramp_rate = rate;
+}
+
+/*See motor.h for additional details*/
+uint8_t get_motor_duty(motor_id id)
+{
+	return ramp[id].duty;
+}
+
+/*See motor.h for additional details*/
+int8_t get_motor_direction(motor_id id)
+{
+	int8_t dir = 0;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		uint8_t phase = ramp[id].phase;
+
+		if((phase == RAMP_RUN) || (phase == RAMP_DOWN))
+		{
+			/*While ramping down the DIR pin still has the old level*/
+			bool level = (phase == RAMP_RUN) ? ramp[id].dir : !ramp[id].dir;
+			dir = level ? MOTOR_DIR_HIGH : MOTOR_DIR_LOW;
+		}
+	}
+
+	return dir;
+}
+
+/*See motor.h for additional details*/
+uint16_t get_motor_current(motor_id id)
+{
+	adc_channel ch = (id == ROTAT_MOTOR) ? ADC_ROTAT_CURRENT : ADC_TRANS_CURRENT;
+	uint32_t ma = ((uint32_t)adc_to_mv(get_adc_average(ch)) * 1000UL) /
+	              MOTOR_CS_MV_PER_A;
+
+	return (ma > UINT16_MAX) ? UINT16_MAX : (uint16_t)ma;
+}
+
+/*See motor.h for additional details*/
+uint16_t get_rotational_motor_current(void)
+{
+	return get_motor_current(ROTAT_MOTOR);
+}
+
+/*See motor.h for additional details*/
+uint16_t get_translational_motor_current(void)
+{
+	return get_motor_current(TRANS_MOTOR);
+}
+
+/*See motor.h for additional details*/
+void init_overcurrent_trip(void)
+{
+#ifdef MOTOR_OVERCURRENT_TRIP
+	/*Comparator inputs, digital buffers off*/
+	DDR(OVERCURRENT_PORT) &= ~((1 << OVERCURRENT_REF_POS) |
+	                           (1 << OVERCURRENT_SENS_POS));
+	PORT(OVERCURRENT_PORT) &= ~((1 << OVERCURRENT_REF_POS) |
+	                            (1 << OVERCURRENT_SENS_POS));
+	DIDR1 |= ((1 << AIN1D) | (1 << AIN0D));
+
+	/*Negative input from AIN1 rather than the ADC multiplexer*/
+	ADCSRB &= ~(1 << ACME);
+
+	/*Interrupt on the falling edge of ACO (AIN1 rising above AIN0),
+	  the interrupt is held off while the mode is changed*/
+	ACSR = (1 << ACIS1);
+	ACSR |= (1 << ACI);
+	ACSR |= (1 << ACIE);
+
+	sei();
+
+	/*Trip at once if the current is already above the threshold*/
+	if(!(ACSR & (1 << ACO)))
+	{
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			trip_motors();
+		}
+	}
+#endif
+}
+
+/*See motor.h for additional details*/
+void disable_overcurrent_trip(void)
+{
+	ACSR &= ~(1 << ACIE);
+	ACSR |= (1 << ACD);
+}
+
+/*See motor.h for additional details*/
+bool get_motor_fault(void)
+{
+	return motor_fault;
+}
+
+/*See motor.h for additional details*/
+bool clear_motor_fault(void)
+{
+	bool cleared = false;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		/*Only re-arm once the current has dropped below the threshold*/
+		if(!motor_fault || (ACSR & (1 << ACD)) || (ACSR & (1 << ACO)))
+		{
+			motor_fault = false;
+			cleared = true;
+		}
+	}
+
+	return cleared;
+}
+
+/*See motor.h for additional details*/
+void set_motor_stop_mode(motor_id id, motor_stop_mode mode)
+{
+	stop_mode[id] = mode;
+}
+
+/*See motor.h for additional details*/
+motor_stop_mode get_motor_stop_mode(motor_id id)
+{
+	return stop_mode[id];
+}
+
+/*See motor.h for additional details*/
+bool motor_stop_done(motor_id id)
+{
+	return (ramp[id].phase == RAMP_OFF);
 }
 
 /** Rotational Motor API **/
@@ -68,31 +671,26 @@ void init_motor_drivers(void)
 /*See motor.h for additional details*/
 void set_rotational_motor_speed(uint8_t speed)
 {
-	OCR2A = (speed < ROTAT_SAFETY_PWM) ? ROTAT_SAFETY_PWM : speed;
+	uint8_t min_duty = ramp[ROTAT_MOTOR].floor;
+	ramp[ROTAT_MOTOR].target = (speed < min_duty) ? min_duty : speed;
 }
 
 /*See motor.h for additional details*/
 void rotational_motor_left(void)
 {
-	PORT(ROTAT_MOTOR_DIR_PORT) &= ~(1 << ROTAT_MOTOR_DIR_POS);
-	/*Enable Clear on Compare Match mode*/
-	TCCR2A |= (1 << COM2A1);
+	request_direction(ROTAT_MOTOR, false);
 }
 
 /*See motor.h for additional details*/
 void rotational_motor_right(void)
 {
-	PORT(ROTAT_MOTOR_DIR_PORT) |= (1 << ROTAT_MOTOR_DIR_POS);
-	/*Enable Clear on Compare Match mode*/
-	TCCR2A |= (1 << COM2A1);
+	request_direction(ROTAT_MOTOR, true);
 }
 
 /*See motor.h for additional details*/
 void brake_rotational_motor(void)
 {
-	PORT(ROTAT_MOTOR_DIR_PORT) &= ~(1 << ROTAT_MOTOR_DIR_POS);
-	/*Disable PWM to stop motors*/
-	TCCR2A &= ~((1 << COM2A1) | (1 << COM2A0));
+	brake_motor(ROTAT_MOTOR);
 }
 
 /** Translational Motor API **/
@@ -100,36 +698,31 @@ void brake_rotational_motor(void)
 /*See motor.h for additional details*/
 void set_translational_motor_speed(uint8_t speed)
 {
-	OCR2B = (speed < TRANS_SAFETY_PWM) ? TRANS_SAFETY_PWM : speed;
+	uint8_t min_duty = ramp[TRANS_MOTOR].floor;
+	ramp[TRANS_MOTOR].target = (speed < min_duty) ? min_duty : speed;
 }
 
 /*See motor.h for additional details*/
 void translational_motor_down(void)
 {
-	PORT(TRANS_MOTOR_DIR_PORT) &= ~(1 << TRANS_MOTOR_DIR_POS);
-	/*Enable Clear on Compare Match mode*/
-	TCCR2A |= (1 << COM2B1); 
+	request_direction(TRANS_MOTOR, false);
 }
 
 /*See motor.h for additional details*/
 void translational_motor_up(void)
 {
-	PORT(TRANS_MOTOR_DIR_PORT) |= (1 << TRANS_MOTOR_DIR_POS);
-	/*Enable Clear on Compare Match mode*/
-	TCCR2A |= (1 << COM2B1);
+	request_direction(TRANS_MOTOR, true);
 }
 
 /*See motor.h for additional details*/
 void brake_translational_motor(void)
 {
-	PORT(TRANS_MOTOR_DIR_PORT) &= ~(1 << TRANS_MOTOR_DIR_POS);
-	/*Disable PWM to stop motors*/
-	TCCR2A &= ~((1 << COM2B1) | (1 << COM2B0));
+	brake_motor(TRANS_MOTOR);
 }
 
 /*See motor.h for additional details*/
 void disable_motors(void)
 {
-	TCCR2B &= ~((1 << CS22) | (1 << CS21) | (1 << CS20));
+	TCCR2B &= ~CS2_MASK;
 }
 /*End of motor.c*/
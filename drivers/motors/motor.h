@@ -17,6 +17,7 @@
  * 		          Includes                  *
  ********************************************/ 
 #include <stdint.h>
+#include <stdbool.h>
 
 /********************************************
  * 		           Macros                   *
@@ -33,6 +34,99 @@
 #define TRANS_MOTOR_PWM_POS  6 //OC2B
 #define TRANS_MOTOR_DIR_POS  3
 
+/*Driver RESET Inputs (low puts the driver to sleep with its
+  outputs off, letting the motor coast)*/
+#define ROTAT_MOTOR_RESET_PORT C
+#define ROTAT_MOTOR_RESET_POS  6
+#define TRANS_MOTOR_RESET_PORT C
+#define TRANS_MOTOR_RESET_POS  7
+
+/*Minimum PWM value allowable by motors, as chosen with Fast PWM
+  at F_CPU/2048 (~3.9kHz at 8MHz). The driver rescales these to the
+  PWM mode and frequency selected at initialization, see
+  get_motor_safety_pwm()*/
+#define TRANS_SAFETY_PWM 50//77  // ~30% --> 3.6V
+#define ROTAT_SAFETY_PWM 50//140 // ~55% --> 6.6V
+
+/*On-time lost to driver switching per PWM period (estimate)*/
+#define MOTOR_SWITCH_LOSS_NS 500
+
+/*PWM frequency selected by init_motor_drivers() (Hz)*/
+#define MOTOR_PWM_FREQ 20000UL
+
+/*Maximum PWM value*/
+#define MOTOR_MAX_PWM 255
+
+/*Default duty change per ramp tick (~1ms), 0 disables ramping*/
+#define MOTOR_RAMP_RATE 2
+
+/*Ramp ticks the output is disabled for during a direction change*/
+#define MOTOR_DEAD_TIME 5
+
+/*Stop timing in ramp ticks (~1ms)*/
+#define MOTOR_COAST_TIME 200 //Coast until treated as stopped
+#define MOTOR_BRAKE_TIME 50  //Dynamic braking until treated as stopped
+#define MOTOR_PLUG_TIME  20  //Reverse drive of a plug brake
+
+/*Duty cycle of the reverse drive of a plug brake*/
+#define MOTOR_PLUG_DUTY 128
+
+/*Values returned by get_motor_direction()*/
+#define MOTOR_DIR_LOW  -1 //DIR low: rotational left, translational down
+#define MOTOR_DIR_OFF   0 //Output disabled
+#define MOTOR_DIR_HIGH  1 //DIR high: rotational right, translational up
+
+/*Current sense output of the 18v25 boards (~20mV per amp)*/
+#define MOTOR_CS_MV_PER_A 20UL
+
+/*Overcurrent Trip Comparator Inputs (fixed by the AVR hardware).
+  AIN0 is held at the trip threshold by a divider, e.g. 600mV for
+  30A, and AIN1 sees the current sense output (the rotational CS,
+  or both CS outputs diode-OR'd). Both pins are shared with the
+  vibration sensors and the LCD, which cannot be used together
+  with the trip. The drill board has no threshold divider or
+  current sense wiring on them, so the trip is only built with
+  MOTOR_OVERCURRENT_TRIP defined.*/
+#define OVERCURRENT_PORT     B
+#define OVERCURRENT_REF_POS  2 //AIN0
+#define OVERCURRENT_SENS_POS 3 //AIN1
+
+/********************************************
+ * 		          Typedefs                  *
+ ********************************************/
+/*Motor Identifiers*/
+typedef enum {
+	ROTAT_MOTOR = 0,
+	TRANS_MOTOR = 1,
+}motor_id;
+
+/*Timer2 PWM Modes (TOP is 0xFF in both so both channels are usable)*/
+typedef enum {
+	MOTOR_FAST_PWM = 0,          // F_CPU / (N * 256)
+	MOTOR_PHASE_CORRECT_PWM = 1, // F_CPU / (N * 510)
+}motor_pwm_mode;
+
+/*Stop Modes used by the brake functions. On the 18v25 a low PWM
+  input shorts the motor through the low side switches, so
+  MOTOR_STOP_BRAKE is dynamic braking, while MOTOR_STOP_COAST puts
+  the driver to sleep through its RESET input*/
+typedef enum {
+	MOTOR_STOP_COAST = 0, //Outputs off, the motor spins down freely
+	MOTOR_STOP_BRAKE = 1, //Windings shorted (dynamic braking)
+	MOTOR_STOP_PLUG  = 2, //Timed reverse drive, then dynamic braking
+}motor_stop_mode;
+
+/*Timer2 Prescaler Values (clock select bits)*/
+typedef enum {
+	MOTOR_PRESCALE_1    = 1,
+	MOTOR_PRESCALE_8    = 2,
+	MOTOR_PRESCALE_32   = 3,
+	MOTOR_PRESCALE_64   = 4,
+	MOTOR_PRESCALE_128  = 5,
+	MOTOR_PRESCALE_256  = 6,
+	MOTOR_PRESCALE_1024 = 7,
+}motor_prescaler;
+
 /********************************************
  * 		      Function Prototypes           *
  ********************************************/
@@ -42,11 +136,169 @@
  * DESCRIPTION:
  *  - Initializes the 8-bit Timer2 and configures PWM and directional
  *    ports for both the rotational and translational motors as
- *    outputs.
+ *    outputs. Enables global interrupts and the Timer2 overflow
+ *    interrupt that runs the duty cycle ramp layer. The PWM
+ *    frequency closest to MOTOR_PWM_FREQ is selected.
  *
  **************************************************************/
 void init_motor_drivers(void);
 
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Same as init_motor_drivers(), but selects the PWM mode and
+ *    prescaler that produce the frequency closest to "freq" (Hz)
+ *    for the configured F_CPU.
+ *
+ **************************************************************/
+void init_motor_drivers_freq(uint32_t freq);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Same as init_motor_drivers(), but uses the given PWM mode and
+ *    prescaler. The safety floors are rescaled so the minimum
+ *    effective duty cycle is unchanged in the new configuration.
+ *
+ **************************************************************/
+void init_motor_drivers_pwm(motor_pwm_mode mode, motor_prescaler ps);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the PWM frequency of the motor outputs in Hz.
+ *
+ **************************************************************/
+uint32_t get_motor_pwm_freq(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the lowest duty cycle a motor will be driven at in
+ *    the active PWM configuration.
+ *
+ **************************************************************/
+uint8_t get_motor_safety_pwm(motor_id id);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Sets how far the duty cycle of either motor may change per
+ *    ramp tick (~1ms). A rate of 0 applies speed changes at once,
+ *    direction changes still pass through the dead time.
+ *
+ **************************************************************/
+void set_motor_ramp_rate(uint8_t rate);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the duty cycle currently applied to a motor by the
+ *    ramp layer. Returns 0 while the motor is braked.
+ *
+ **************************************************************/
+uint8_t get_motor_duty(motor_id id);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the direction a motor is currently being driven in
+ *    as the level of its DIR pin (MOTOR_DIR_LOW or MOTOR_DIR_HIGH),
+ *    or MOTOR_DIR_OFF while the motor is braked or in the dead time
+ *    of a direction change.
+ *
+ **************************************************************/
+int8_t get_motor_direction(motor_id id);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the current drawn by a motor in milliamps, from the
+ *    filtered current sense samples of the ADC driver. The ADC
+ *    must have been started with init_adc(). The translational
+ *    current reads 0 unless the ADC driver is built with
+ *    ADC_ALL_CHANNELS (see adc.h). Never blocks.
+ *
+ **************************************************************/
+uint16_t get_motor_current(motor_id id);
+uint16_t get_rotational_motor_current(void);
+uint16_t get_translational_motor_current(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Configures the analog comparator as a hardware overcurrent
+ *    detector. When the current sense input rises above the
+ *    threshold on AIN0, the comparator interrupt disconnects the
+ *    PWM output of both motors within a few microseconds and
+ *    latches a fault. While the fault is latched both motors stay
+ *    braked and direction requests are ignored. Enables global
+ *    interrupts. Does nothing unless built with
+ *    MOTOR_OVERCURRENT_TRIP defined, see OVERCURRENT_PORT.
+ *
+ **************************************************************/
+void init_overcurrent_trip(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Disables the overcurrent comparator. A latched fault remains
+ *    latched until cleared.
+ *
+ **************************************************************/
+void disable_overcurrent_trip(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns true while an overcurrent fault is latched.
+ *
+ **************************************************************/
+bool get_motor_fault(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Clears a latched overcurrent fault so the motors can be
+ *    driven again. Both motors remain braked until commanded.
+ *    The fault is not cleared, and false is returned, while the
+ *    current is still above the threshold. Returns true if no
+ *    fault is latched.
+ *
+ **************************************************************/
+bool clear_motor_fault(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Selects how the brake functions stop a motor. Defaults to
+ *    MOTOR_STOP_BRAKE. A plug brake reverses the motor at
+ *    MOTOR_PLUG_DUTY for MOTOR_PLUG_TIME after a dead time and
+ *    must be tuned so the motor does not start turning backwards.
+ *    A motor that is not being driven is always dynamically braked.
+ *
+ **************************************************************/
+void set_motor_stop_mode(motor_id id, motor_stop_mode mode);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the stop mode of a motor.
+ *
+ **************************************************************/
+motor_stop_mode get_motor_stop_mode(motor_id id);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns true once a stop started by a brake function has run
+ *    its full time (MOTOR_COAST_TIME, or MOTOR_BRAKE_TIME after any
+ *    plug drive), and the motor is idle. Returns false while the
+ *    motor is driven or stopping.
+ *
+ **************************************************************/
+bool motor_stop_done(motor_id id);
+
 /* Rotational Motor Functions */
 
 /***************************************************************
@@ -57,6 +309,7 @@ void init_motor_drivers(void);
  *    between 140 and 255. If the input value is less than 140,
  *    the speed will default to 140. This ensures the duty cycle
  *    will be large enough to avoid damaging the motor (~55%).
+ *    The applied duty cycle slews to the new value at the ramp rate.
  *
  **************************************************************/
 void set_rotational_motor_speed(uint8_t speed);
@@ -65,8 +318,8 @@ void set_rotational_motor_speed(uint8_t speed);
  *
  * DESCRIPTION:
  *  - Turns the rotational motor to the right at the define speed.
- *    This function should always be preceeded by a call to the
- *    brake_rotational_motor() function.
+ *    If the motor is turning left, it is ramped down, held off for
+ *    the dead time and ramped back up in the new direction.
  *
  **************************************************************/
 void rotational_motor_right(void);
@@ -75,8 +328,8 @@ void rotational_motor_right(void);
  *
  * DESCRIPTION:
  *  - Turns the rotational motor to the left at the define speed.
- *    This function should always be preceeded by a call to the
- *    brake_rotational_motor() function.
+ *    If the motor is turning right, it is ramped down, held off for
+ *    the dead time and ramped back up in the new direction.
  *
  **************************************************************/
 void rotational_motor_left(void);
@@ -84,7 +337,9 @@ void rotational_motor_left(void);
 /***************************************************************
  *
  * DESCRIPTION:
- *  - Forces the rotational motor to brake.
+ *  - Stops the rotational motor in its stop mode. Takes effect at
+ *    once, without ramping. Completion is reported by
+ *    motor_stop_done().
  *
  **************************************************************/
 void brake_rotational_motor(void);
@@ -99,6 +354,7 @@ void brake_rotational_motor(void);
  *    between 77 and 255. If the input value is less than 77,
  *    the speed will default to 77. This ensures the duty cycle
  *    will be large enough to avoid damaging the motor (~30%).
+ *    The applied duty cycle slews to the new value at the ramp rate.
  *
  **************************************************************/
 void set_translational_motor_speed(uint8_t speed);
@@ -107,9 +363,9 @@ void set_translational_motor_speed(uint8_t speed);
  *
  * DESCRIPTION:
  *  - Turns motor the translational motor at the defined speed
- *    such that the attached object raises. This function should 
- *    always be preceeded by a call to the brake_translational_motor() 
- *    function.
+ *    such that the attached object raises. If the motor is
+ *    lowering, it is ramped down, held off for the dead time and
+ *    ramped back up in the new direction.
  *
  **************************************************************/
 void translational_motor_up(void);
@@ -118,9 +374,9 @@ void translational_motor_up(void);
  *
  * DESCRIPTION:
  *  - Turns motor the translational motor at the defined speed
- *    such that the attached object lowers. This function should 
- *    always be preceeded by a call to the brake_translational_motor() 
- *    function.
+ *    such that the attached object lowers. If the motor is
+ *    raising, it is ramped down, held off for the dead time and
+ *    ramped back up in the new direction.
  *
  **************************************************************/
 void translational_motor_down(void);
@@ -128,7 +384,9 @@ void translational_motor_down(void);
 /***************************************************************
  *
  * DESCRIPTION:
- *  - Forces the translational motor to brake.
+ *  - Stops the translational motor in its stop mode. Takes effect at
+ *    once, without ramping. Completion is reported by
+ *    motor_stop_done().
  *
  **************************************************************/
 void brake_translational_motor(void);
@@ -0,0 +1,120 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Implementation of the fixed-point PID controller. See pid.h
+ *    for further details.
+ *
+ **************************************************************/
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include "pid.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Rounding constant for the Q8.8 to integer conversion*/
+#define PID_ROUND (1L << (PID_Q - 1))
+
+/********************************************
+ * 	    Static Function Prototypes          *
+ ********************************************/
+static int32_t clamp(int32_t val, int32_t lo, int32_t hi);
+
+/*Limit a value to the range [lo,hi]*/
+static int32_t clamp(int32_t val, int32_t lo, int32_t hi)
+{
+	if(val < lo) return lo;
+	if(val > hi) return hi;
+	return val;
+}
+
+/********************************************
+ * 		        API Functions               *
+ ********************************************/
+/*See pid.h for details*/
+void init_pid(pid_ctl *pid, int16_t kp, int16_t ki, int16_t kd,
+              int16_t out_min, int16_t out_max)
+{
+	pid->kp = kp;
+	pid->ki = ki;
+	pid->kd = kd;
+	pid->out_min = out_min;
+	pid->out_max = out_max;
+	pid->integ = 0;
+	pid->prev_meas = 0;
+	pid->primed = false;
+}
+
+/*See pid.h for details*/
+void set_pid_gains(pid_ctl *pid, int16_t kp, int16_t ki, int16_t kd)
+{
+	pid->kp = kp;
+	pid->ki = ki;
+	pid->kd = kd;
+}
+
+/*See pid.h for details*/
+void set_pid_limits(pid_ctl *pid, int16_t out_min, int16_t out_max)
+{
+	pid->out_min = out_min;
+	pid->out_max = out_max;
+	pid->integ = clamp(pid->integ, (int32_t)out_min << PID_Q,
+	                   (int32_t)out_max << PID_Q);
+}
+
+/*See pid.h for details*/
+void reset_pid(pid_ctl *pid, int16_t output)
+{
+	pid->integ = clamp((int32_t)output << PID_Q,
+	                   (int32_t)pid->out_min << PID_Q,
+	                   (int32_t)pid->out_max << PID_Q);
+	pid->primed = false;
+}
+
+/*See pid.h for details*/
+int16_t update_pid(pid_ctl *pid, int16_t setpoint, int16_t meas)
+{
+	int32_t lo = (int32_t)pid->out_min << PID_Q;
+	int32_t hi = (int32_t)pid->out_max << PID_Q;
+
+	/*Keep the error within 16 bits so the products fit in 32 bits*/
+	int32_t err = clamp((int32_t)setpoint - meas, INT16_MIN, INT16_MAX);
+
+	/*Derivative on measurement, skipped until a history exists*/
+	int32_t d_meas = pid->primed ? clamp((int32_t)meas - pid->prev_meas,
+	                                     INT16_MIN, INT16_MAX) : 0;
+	pid->prev_meas = meas;
+	pid->primed = true;
+
+	int32_t p_term = (int32_t)pid->kp * err;
+	int32_t d_term = -((int32_t)pid->kd * d_meas);
+
+	/*Candidate integral term*/
+	int32_t integ = clamp(pid->integ + (int32_t)pid->ki * err, lo, hi);
+	int32_t out = p_term + integ + d_term;
+
+	/*Conditional integration: hold the integral while the output
+	  is saturated and the error would drive it further*/
+	if(((out > hi) && (err > 0)) || ((out < lo) && (err < 0)))
+	{
+		integ = pid->integ;
+		out = p_term + integ + d_term;
+	}
+	pid->integ = integ;
+
+	out = clamp(out + PID_ROUND, lo, hi + PID_ROUND - 1) >> PID_Q;
+
+	return (int16_t)out;
+}
+
+/*See pid.h for details*/
+void shift_pid(pid_ctl *pid, int16_t offset)
+{
+	pid->prev_meas += offset;
+}
+/* End of pid.c */
@@ -0,0 +1,114 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Fixed-point PID controller. Gains are Q8.8 values (256
+ *    represents a gain of 1.0) and all arithmetic is performed
+ *    with 32-bit integers, so the module has no dependency on
+ *    floating point or AVR hardware and can also be compiled
+ *    on a host for simulation. The integral term is protected
+ *    against windup by clamping and conditional integration,
+ *    and the derivative term acts on the measurement to avoid
+ *    setpoint kick. The caller is responsible for running the
+ *    update at a fixed rate.
+ *
+ **************************************************************/
+
+#ifndef PID_H_
+#define PID_H_
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Fractional bits of the gain values*/
+#define PID_Q 8
+
+/*Converts a whole number gain to Q8.8*/
+#define PID_GAIN(g) ((int16_t)((g) * (1 << PID_Q)))
+
+/********************************************
+ * 		          Structs                   *
+ ********************************************/
+/*PID Controller State*/
+typedef struct {
+	int16_t kp;        //Proportional gain (Q8.8)
+	int16_t ki;        //Integral gain per update (Q8.8)
+	int16_t kd;        //Derivative gain per update (Q8.8)
+	int16_t out_min;   //Lowest output value
+	int16_t out_max;   //Highest output value
+	int32_t integ;     //Integral term scaled by 2^PID_Q
+	int16_t prev_meas; //Measurement from the previous update
+	bool primed;       //prev_meas holds a valid measurement
+}pid_ctl;
+
+/********************************************
+ * 		      Function Prototypes           *
+ ********************************************/
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Initializes a PID controller with the given Q8.8 gains and
+ *    output limits. The integral term is cleared.
+ *
+ **************************************************************/
+void init_pid(pid_ctl *pid, int16_t kp, int16_t ki, int16_t kd,
+              int16_t out_min, int16_t out_max);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Changes the Q8.8 gains of a running controller. The integral
+ *    term is retained so the output does not jump.
+ *
+ **************************************************************/
+void set_pid_gains(pid_ctl *pid, int16_t kp, int16_t ki, int16_t kd);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Changes the output limits of a controller. The integral term
+ *    is clamped to the new limits.
+ *
+ **************************************************************/
+void set_pid_limits(pid_ctl *pid, int16_t out_min, int16_t out_max);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Resets the controller history and preloads the integral term
+ *    so the next output starts from "output". Used for bumpless
+ *    transfer when the loop is (re)started while the actuator is
+ *    already being driven.
+ *
+ **************************************************************/
+void reset_pid(pid_ctl *pid, int16_t output);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Runs one controller update and returns the new output,
+ *    limited to the configured range. Must be called at a fixed
+ *    rate for the integral and derivative gains to be meaningful.
+ *
+ **************************************************************/
+int16_t update_pid(pid_ctl *pid, int16_t setpoint, int16_t meas);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Moves the measurement history by "offset". Used when the
+ *    setpoint and measurement are re-expressed from a new origin,
+ *    so the derivative term does not see a step.
+ *
+ **************************************************************/
+void shift_pid(pid_ctl *pid, int16_t offset);
+
+#endif
+/* End of pid.h */
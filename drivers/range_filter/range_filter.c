@@ -0,0 +1,251 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Implementation of the median range filter. See range_filter.h
+ *    for further details.
+ *
+ *    Heap positions run from -size/2 to size/2 with the median at
+ *    0. The parent of position i is i/2, so positions 1 and -1 are
+ *    the roots of the min-heap and max-heap and both hang off the
+ *    median. Every value in the min-heap is at least the median and
+ *    every value in the max-heap at most the median.
+ *
+ **************************************************************/
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include "range_filter.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Value index held at heap position i*/
+#define HEAP(filt,i) ((filt)->heap[(i) + ((filt)->size >> 1)])
+
+/*Values in the min-heap and the max-heap*/
+#define MIN_COUNT(filt) (((filt)->count - 1) >> 1)
+#define MAX_COUNT(filt) ((filt)->count >> 1)
+
+/*Readings covered by the confidence history*/
+#define HISTORY_LEN 8
+
+/********************************************
+ * 	    Static Function Prototypes          *
+ ********************************************/
+static bool less(const range_filter *filt, int8_t i, int8_t j);
+static void swap(range_filter *filt, int8_t i, int8_t j);
+static void min_sort_down(range_filter *filt, int8_t i);
+static void max_sort_down(range_filter *filt, int8_t i);
+static bool min_sort_up(range_filter *filt, int8_t i);
+static bool max_sort_up(range_filter *filt, int8_t i);
+static void insert(range_filter *filt, uint16_t range);
+
+/*Returns true if the value at position i is less than at j*/
+static bool less(const range_filter *filt, int8_t i, int8_t j)
+{
+	return filt->data[HEAP(filt, i)] < filt->data[HEAP(filt, j)];
+}
+
+/*Exchanges the values at positions i and j*/
+static void swap(range_filter *filt, int8_t i, int8_t j)
+{
+	int8_t t = HEAP(filt, i);
+
+	HEAP(filt, i) = HEAP(filt, j);
+	HEAP(filt, j) = t;
+	filt->pos[HEAP(filt, i)] = i;
+	filt->pos[HEAP(filt, j)] = j;
+}
+
+/*Moves the value at position i down the min-heap*/
+static void min_sort_down(range_filter *filt, int8_t i)
+{
+	int8_t last = MIN_COUNT(filt);
+
+	for(;;)
+	{
+		int8_t c = (i == 0) ? 1 : 2 * i;
+
+		if(c > last) return;
+		/*Smaller child*/
+		if((c < last) && less(filt, c + 1, c)) c++;
+		if(!less(filt, c, i)) return;
+		swap(filt, c, i);
+		i = c;
+	}
+}
+
+/*Moves the value at position i down the max-heap*/
+static void max_sort_down(range_filter *filt, int8_t i)
+{
+	int8_t last = -MAX_COUNT(filt);
+
+	for(;;)
+	{
+		int8_t c = (i == 0) ? -1 : 2 * i;
+
+		if(c < last) return;
+		/*Larger child*/
+		if((c > last) && less(filt, c, c - 1)) c--;
+		if(!less(filt, i, c)) return;
+		swap(filt, c, i);
+		i = c;
+	}
+}
+
+/*Moves the value at position i up the min-heap, returns true if it
+  became the median*/
+static bool min_sort_up(range_filter *filt, int8_t i)
+{
+	while((i > 0) && less(filt, i, i / 2))
+	{
+		swap(filt, i, i / 2);
+		i /= 2;
+	}
+
+	return (i == 0);
+}
+
+/*Moves the value at position i up the max-heap, returns true if it
+  became the median*/
+static bool max_sort_up(range_filter *filt, int8_t i)
+{
+	while((i < 0) && less(filt, i / 2, i))
+	{
+		swap(filt, i, i / 2);
+		i /= 2;
+	}
+
+	return (i == 0);
+}
+
+/*Replaces the oldest value of the window*/
+static void insert(range_filter *filt, uint16_t range)
+{
+	bool fresh = (filt->count < filt->size);
+	int8_t p = filt->pos[filt->next];
+	uint16_t old = filt->data[filt->next];
+
+	filt->data[filt->next] = range;
+	if(++filt->next == filt->size) filt->next = 0;
+	if(fresh) filt->count++;
+
+	/*A new value always sits at the end of its heap, so it can only
+	  move up. A replaced value moves away from the median if it grew
+	  in the min-heap or shrank in the max-heap. A value that reaches
+	  the median pushes the old median into the other heap.*/
+	if(p > 0)
+	{
+		if(!fresh && (range > old)) min_sort_down(filt, p);
+		else if(min_sort_up(filt, p)) max_sort_down(filt, 0);
+	}
+	else if(p < 0)
+	{
+		if(!fresh && (range < old)) max_sort_down(filt, p);
+		else if(max_sort_up(filt, p)) min_sort_down(filt, 0);
+	}
+	else
+	{
+		max_sort_down(filt, 0);
+		min_sort_down(filt, 0);
+	}
+}
+
+/********************************************
+ * 		        API Functions               *
+ ********************************************/
+/*See range_filter.h for details*/
+void init_range_filter(range_filter *filt, uint8_t size, uint16_t gate)
+{
+	if(size > RANGE_MEDIAN_MAX) size = RANGE_MEDIAN_MAX;
+	if(size == 0) size = 1;
+
+	filt->size = size | 1;
+	filt->gate = gate;
+	reset_range_filter(filt);
+}
+
+/*See range_filter.h for details*/
+void reset_range_filter(range_filter *filt)
+{
+	/*Values fill the median first, then the heaps alternately*/
+	for(int8_t k = 0; k < filt->size; k++)
+	{
+		int8_t p = (k + 1) / 2;
+
+		filt->pos[k] = (k & 1) ? -p : p;
+		HEAP(filt, filt->pos[k]) = k;
+		filt->data[k] = 0;
+	}
+
+	filt->count = 0;
+	filt->next = 0;
+	filt->rejects = 0;
+	filt->history = 0;
+}
+
+/*See range_filter.h for details*/
+bool update_range_filter(range_filter *filt, uint16_t range)
+{
+	bool accept = (range != 0);
+
+	/*Rate-of-change gate against the median*/
+	if(accept && (filt->count > 0) && (filt->gate > 0))
+	{
+		uint16_t median = get_range_median(filt);
+		uint16_t step = (range > median) ? (range - median) :
+		                                   (median - range);
+
+		if(step > filt->gate)
+		{
+			/*The range has really moved, start again from here*/
+			if(++filt->rejects >= RANGE_GATE_RELOCK)
+			{
+				uint8_t history = filt->history;
+
+				reset_range_filter(filt);
+				filt->history = history;
+			}
+			else
+			{
+				accept = false;
+			}
+		}
+	}
+
+	filt->history <<= 1;
+	if(accept)
+	{
+		insert(filt, range);
+		filt->rejects = 0;
+		filt->history |= 1;
+	}
+
+	return accept;
+}
+
+/*See range_filter.h for details*/
+uint16_t get_range_median(const range_filter *filt)
+{
+	if(filt->count == 0) return 0;
+
+	return filt->data[HEAP(filt, 0)];
+}
+
+/*See range_filter.h for details*/
+uint8_t get_range_confidence(const range_filter *filt)
+{
+	uint8_t hits = 0;
+
+	for(uint8_t h = filt->history; h; h >>= 1)
+	{
+		hits += (h & 1);
+	}
+
+	return (hits * RANGE_CONFIDENCE_MAX) / HISTORY_LEN;
+}
+/* End of range_filter.c */
@@ -0,0 +1,110 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Outlier filter for a stream of range readings. Each reading
+ *    passes a rate-of-change gate against the current median and
+ *    accepted readings enter a sliding window whose median is the
+ *    filter output.
+ *
+ *    The median is kept by a "mediator": the window is stored as
+ *    a max-heap of the lower half and a min-heap of the upper half
+ *    sharing one index array with the median at its centre, and
+ *    each value records its heap position. Replacing the oldest
+ *    value only moves it up or down its heap, so an update costs
+ *    O(log N) comparisons and no sorting is ever done.
+ *
+ *    Dropouts and gated readings lower a confidence score taken
+ *    over the last 8 readings. Readings that keep failing the gate
+ *    are taken as a real step in the range, for example the drill
+ *    settling onto the ground, and restart the window.
+ *
+ **************************************************************/
+
+#ifndef RANGE_FILTER_H_
+#define RANGE_FILTER_H_
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Largest median window*/
+#define RANGE_MEDIAN_MAX 9
+
+/*Consecutive gated readings that restart the window*/
+#define RANGE_GATE_RELOCK 3
+
+/*Full confidence*/
+#define RANGE_CONFIDENCE_MAX 100
+
+/********************************************
+ * 		          Structs                   *
+ ********************************************/
+/*Range Filter State*/
+typedef struct {
+	uint16_t data[RANGE_MEDIAN_MAX]; //Window, circular by age
+	int8_t pos[RANGE_MEDIAN_MAX];    //Heap position of each value
+	int8_t heap[RANGE_MEDIAN_MAX];   //Value indexes, median at centre
+	uint8_t size;                    //Window length (odd)
+	uint8_t count;                   //Values in the window
+	uint8_t next;                    //Oldest value, replaced next
+	uint16_t gate;                   //Largest step from the median
+	uint8_t rejects;                 //Consecutive gated readings
+	uint8_t history;                 //Accepted readings, 1 bit each
+}range_filter;
+
+/********************************************
+ * 		      Function Prototypes           *
+ ********************************************/
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Initializes an empty filter with a median of "size" readings
+ *    and a gate of "gate" units per reading. The size is made odd
+ *    and limited to RANGE_MEDIAN_MAX. A gate of 0 disables gating.
+ *
+ **************************************************************/
+void init_range_filter(range_filter *filt, uint8_t size, uint16_t gate);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Empties the window and clears the confidence.
+ *
+ **************************************************************/
+void reset_range_filter(range_filter *filt);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Adds a reading to the filter. A reading of 0 is a dropout.
+ *    Returns true if the reading entered the window.
+ *
+ **************************************************************/
+bool update_range_filter(range_filter *filt, uint16_t range);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the median of the window, or 0 if it is empty.
+ *
+ **************************************************************/
+uint16_t get_range_median(const range_filter *filt);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the share of the last 8 readings that entered the
+ *    window, 0 to RANGE_CONFIDENCE_MAX.
+ *
+ **************************************************************/
+uint8_t get_range_confidence(const range_filter *filt);
+
+#endif
+/* End of range_filter.h */
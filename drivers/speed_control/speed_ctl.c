@@ -0,0 +1,121 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Implementation of the rotational motor speed controller.
+ *    See speed_ctl.h for further details.
+ *
+ **************************************************************/
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include "speed_ctl.h"
+#include "pid.h"
+#include "encoder.h"
+#include "motor.h"
+#include <util/atomic.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 	          Global Variables              *
+ ********************************************/
+/*Rotational speed PID state*/
+static pid_ctl rotat_pid;
+
+/*Target velocity in edges per window*/
+static volatile uint16_t rotat_target = 0;
+
+/*Duty cycle last written to the motor driver*/
+static volatile uint8_t rotat_duty = 0;
+
+/*Set while the controller drives the motor duty*/
+static volatile bool running = false;
+
+/********************************************
+ * 	    Static Function Prototypes          *
+ ********************************************/
+static void speed_ctl_tick(void);
+
+/*Runs the controller, called by the encoder ISR once per window*/
+static void speed_ctl_tick(void)
+{
+	if(!running) return;
+
+	/*Hold the output at the floor while the motor is braked, so the
+	  next start is bumpless and nothing winds up*/
+	if(get_motor_direction(ROTAT_MOTOR) == MOTOR_DIR_OFF)
+	{
+		rotat_duty = get_motor_safety_pwm(ROTAT_MOTOR);
+		reset_pid(&rotat_pid, rotat_duty);
+		return;
+	}
+
+	rotat_duty = (uint8_t)update_pid(&rotat_pid, (int16_t)rotat_target,
+	                                 (int16_t)get_rotat_encoder_velocity());
+	set_rotational_motor_speed(rotat_duty);
+}
+
+/********************************************
+ * 		        API Functions               *
+ ********************************************/
+/*See speed_ctl.h for details*/
+void init_rotat_speed_ctl(void)
+{
+	uint8_t min_duty = get_motor_safety_pwm(ROTAT_MOTOR);
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		init_pid(&rotat_pid, ROTAT_SPEED_KP, ROTAT_SPEED_KI, ROTAT_SPEED_KD,
+		         min_duty, MOTOR_MAX_PWM);
+		reset_pid(&rotat_pid, min_duty);
+		rotat_target = 0;
+		rotat_duty = min_duty;
+		running = true;
+	}
+	set_encoder_window_hook(speed_ctl_tick);
+}
+
+/*See speed_ctl.h for details*/
+void stop_rotat_speed_ctl(void)
+{
+	running = false;
+}
+
+
+/*See speed_ctl.h for details*/
+void set_rotat_speed_gains(int16_t kp, int16_t ki, int16_t kd)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		set_pid_gains(&rotat_pid, kp, ki, kd);
+	}
+}
+
+/*See speed_ctl.h for details*/
+void set_rotat_speed_target(uint16_t vel)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		rotat_target = (vel > ROTAT_SPEED_MAX) ? ROTAT_SPEED_MAX : vel;
+	}
+}
+
+/*See speed_ctl.h for details*/
+uint16_t get_rotat_speed_target(void)
+{
+	uint16_t vel;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		vel = rotat_target;
+	}
+	return vel;
+}
+
+/*See speed_ctl.h for details*/
+uint8_t get_rotat_speed_duty(void)
+{
+	return rotat_duty;
+}
+/* End of speed_ctl.c */
@@ -0,0 +1,106 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Closed-loop speed control of the rotational (auger) motor.
+ *    A fixed-point PID controller compares the rotational encoder
+ *    velocity against a target velocity and drives the rotational
+ *    motor duty cycle through set_rotational_motor_speed(), so the
+ *    motor.c safety limits always apply. The controller runs once
+ *    per encoder velocity window (~100Hz) from the encoder ISR
+ *    window hook, so it keeps a fixed rate whatever the application
+ *    loop is doing. While the motor is braked the output is held at
+ *    the safety floor.
+ *
+ **************************************************************/
+
+#ifndef SPEED_CTL_H_
+#define SPEED_CTL_H_
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "pid.h"
+#include "encoder.h"
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Default rotational speed controller gains (Q8.8)*/
+#define ROTAT_SPEED_KP PID_GAIN(1.0)
+#define ROTAT_SPEED_KI PID_GAIN(0.25)
+#define ROTAT_SPEED_KD PID_GAIN(0)
+
+/*Highest speed target, kept clear of the fastest velocity the
+  encoder sampler can measure (edges per window)*/
+#define ROTAT_SPEED_MAX ((ENCODER_MAX_VELOCITY * 9) / 10)
+
+/*Auger drilling speed (edges per window)*/
+#define ROTAT_DRILL_SPEED ((ENCODER_MAX_VELOCITY * 4) / 5)
+
+/********************************************
+ * 		      Function Prototypes           *
+ ********************************************/
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Initializes the rotational speed controller with the default
+ *    gains and a target velocity of zero, and starts running it
+ *    from the encoder window tick. The encoder and motor drivers
+ *    must be initialized first. Takes over the encoder window hook.
+ *
+ **************************************************************/
+void init_rotat_speed_ctl(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Stops the controller from changing the motor duty, e.g. to
+ *    drive the motor open loop with set_rotational_motor_speed().
+ *    init_rotat_speed_ctl() starts it again.
+ *
+ **************************************************************/
+void stop_rotat_speed_ctl(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Changes the controller gains at runtime. Gains are Q8.8
+ *    values, see PID_GAIN() in pid.h.
+ *
+ **************************************************************/
+void set_rotat_speed_gains(int16_t kp, int16_t ki, int16_t kd);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Sets the target velocity of the rotational motor in encoder
+ *    edges per velocity window (see encoder.h). Limited to
+ *    ROTAT_SPEED_MAX.
+ *
+ **************************************************************/
+void set_rotat_speed_target(uint16_t vel);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the target velocity of the rotational motor in encoder
+ *    edges per velocity window.
+ *
+ **************************************************************/
+uint16_t get_rotat_speed_target(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the duty cycle most recently commanded by the
+ *    controller.
+ *
+ **************************************************************/
+uint8_t get_rotat_speed_duty(void);
+
+#endif
+/* End of speed_ctl.h */
@@ -0,0 +1,256 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host step-response benchmark for the rotational speed
+ *    controller. Runs speed_ctl.c, pid.c, encoder.c and motor.c
+ *    against the register stand-ins in host_sim, with a first-order
+ *    DC motor model driving the rotational encoder inputs. The
+ *    encoder ISR samples the quadrature pins at its real rate and
+ *    the controller runs from its window hook, so the duty floor
+ *    from get_motor_safety_pwm() and the ramp layer apply as on the
+ *    drill. Rise time, overshoot, settling time and steady-state
+ *    error are reported, followed by the response to soil load
+ *    changes. An open-loop duty giving the target speed unloaded is
+ *    simulated for comparison.
+ *
+ *    Each run also compares the velocity measured by the encoder
+ *    driver with the edges the motor really made. A last run at
+ *    full duty shows the measurement aliasing once the motor is
+ *    faster than ENCODER_MAX_VELOCITY.
+ *
+ *    The motor constants below are estimates and should be
+ *    replaced with values measured on the drill.
+ *
+ *      make sim
+ *
+ **************************************************************/
+
+#include "speed_ctl.h"
+#include "encoder.h"
+#include "motor.h"
+#include <avr/io.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+/*Motor model*/
+#define FREE_SPEED  112.0  //Edges per window at full duty, no load (150rpm)
+#define TIME_CONST  0.06   //Mechanical time constant in seconds
+
+/*Timer clocks*/
+#define TIMER0_HZ 1000000.0 //F_CPU / 8
+
+/*Test profile*/
+#define TARGET      ROTAT_DRILL_SPEED
+#define WINDOWS     450    //4.5 seconds
+#define CLAY_START  150    //Heavy load applied
+#define LOOSE_START 300    //Light load applied
+#define CLAY_LOAD   0.35   //Fraction of free speed lost
+#define LOOSE_LOAD  -0.10  //Soil assists the auger
+
+/*Windows of the full duty run*/
+#define FULL_WINDOWS 50
+
+/*Interrupt vectors of encoder.c and motor.c*/
+void TIMER0_COMPA_vect(void);
+void TIMER2_OVF_vect(void);
+
+/*Timer interrupt enable bits and Timer2 output and mode bits*/
+#define OCIE0A 1
+#define TOIE2  0
+#define COM2A1 7
+#define WGM21  1
+
+/*Quadrature states in order of rotation*/
+static const uint8_t gray[4] = {0, 1, 3, 2};
+
+/*Motor state*/
+static double speed = 0;    //Edges per second
+static double position = 0; //Edges turned
+
+/*Ramp ticks owed to the Timer2 overflow vector*/
+static double ovf_due = 0;
+
+/*Duty cycle applied to the motor, 0 while the output is off*/
+static double applied_duty(void)
+{
+	if(!(TCCR2A & (1 << COM2A1))) return 0;
+	if(TCCR2A & (1 << WGM21)) return (OCR2A + 1) / 256.0;
+	return OCR2A / 255.0;
+}
+
+/*Advances the motor and timers by one encoder sample, then samples*/
+static void step(double load)
+{
+	double dt = (get_sampling_rate() + 1) / TIMER0_HZ;
+	double free = FREE_SPEED * ENCODER_WINDOW_HZ;
+	double drive = free * applied_duty() - load * free;
+
+	/*Ramp layer ticks at the PWM frequency*/
+	ovf_due += get_motor_pwm_freq() * dt;
+	while(ovf_due >= 1)
+	{
+		if(TIMSK2 & (1 << TOIE2)) TIMER2_OVF_vect();
+		ovf_due -= 1;
+	}
+
+	/*Soil load slows the auger but does not turn it backwards*/
+	speed += (drive - speed) * dt / TIME_CONST;
+	if(speed < 0) speed = 0;
+	position += speed * dt;
+
+	uint8_t state = gray[(uint32_t)position & 0x03];
+	PIND = (PIND & ~((1 << ROTAT_ENCODER_A_POS) | (1 << ROTAT_ENCODER_B_POS))) |
+	       (state << ROTAT_ENCODER_A_POS);
+
+	if(TIMSK0 & (1 << OCIE0A)) TIMER0_COMPA_vect();
+}
+
+/*Runs one velocity window, returning the measured velocity and the
+  edges the motor really turned*/
+static uint16_t run_window(double load, double *edges)
+{
+	uint8_t window = get_encoder_window();
+	double start = position;
+
+	while(get_encoder_window() == window) step(load);
+	*edges = position - start;
+
+	return get_rotat_encoder_velocity();
+}
+
+/*Brings the motor to rest with the speed controller running*/
+static void rest(void)
+{
+	double edges;
+
+	brake_rotational_motor();
+	for(int w = 0; w < 100; w++) run_window(0, &edges);
+	speed = 0;
+}
+
+/*Soil load at a given window*/
+static double load_at(int w)
+{
+	if(w >= LOOSE_START) return LOOSE_LOAD;
+	if(w >= CLAY_START) return CLAY_LOAD;
+	return 0;
+}
+
+/*Report the step response and load rejection of one run*/
+static void report(const char *name, const uint16_t *vel, double worst)
+{
+	int rise_lo = -1, rise_hi = -1, settle = 0;
+	uint16_t peak = 0;
+	long sum_err = 0;
+
+	for(int w = 0; w < CLAY_START; w++)
+	{
+		if((rise_lo < 0) && (vel[w] >= TARGET / 10)) rise_lo = w;
+		if((rise_hi < 0) && (vel[w] >= (TARGET * 9) / 10)) rise_hi = w;
+		if(vel[w] > peak) peak = vel[w];
+		if(abs((int)vel[w] - TARGET) > (TARGET / 50)) settle = w + 1;
+	}
+
+	for(int w = CLAY_START - 50; w < CLAY_START; w++)
+	{
+		sum_err += (long)vel[w] - TARGET;
+	}
+
+	printf("%s\n", name);
+	if(rise_hi < 0)
+	{
+		printf("  rise time (10-90%%)   : never reached 90%%\n");
+	}
+	else
+	{
+		printf("  rise time (10-90%%)   : %d ms\n", (rise_hi - rise_lo) * 10);
+	}
+	printf("  overshoot            : %.1f %%\n",
+	       peak > TARGET ? 100.0 * (peak - TARGET) / TARGET : 0.0);
+	printf("  settling time (2%%)   : %d ms\n", settle * 10);
+	printf("  steady-state error   : %.1f edges/window\n", sum_err / 50.0);
+
+	/*Load rejection, mean speed over the end of each load phase*/
+	double clay = 0, loose = 0;
+	for(int w = LOOSE_START - 50; w < LOOSE_START; w++) clay += vel[w];
+	for(int w = WINDOWS - 50; w < WINDOWS; w++) loose += vel[w];
+	printf("  speed in clay        : %.1f (%+.1f %%)\n", clay / 50,
+	       100.0 * (clay / 50 - TARGET) / TARGET);
+	printf("  speed in loose soil  : %.1f (%+.1f %%)\n", loose / 50,
+	       100.0 * (loose / 50 - TARGET) / TARGET);
+	printf("  worst measurement    : %.1f edges/window from the true speed\n",
+	       worst);
+}
+
+int main(void)
+{
+	static uint16_t closed[WINDOWS];
+	static uint16_t open[WINDOWS];
+	double edges, closed_worst = 0, open_worst = 0;
+
+	init_encoders();
+	init_motor_drivers();
+	brake_rotational_motor();
+	start_encoders();
+	init_rotat_speed_ctl();
+
+	printf("Rotational speed step response, target %d edges/window\n",
+	       TARGET);
+	printf("Kp=%.3f Ki=%.3f Kd=%.3f, duty floor %u at %luHz\n\n",
+	       ROTAT_SPEED_KP / 256.0, ROTAT_SPEED_KI / 256.0,
+	       ROTAT_SPEED_KD / 256.0, get_motor_safety_pwm(ROTAT_MOTOR),
+	       (unsigned long)get_motor_pwm_freq());
+
+	/*Closed loop with the default gains*/
+	set_rotat_speed_target(TARGET);
+	rotational_motor_right();
+	for(int w = 0; w < WINDOWS; w++)
+	{
+		closed[w] = run_window(load_at(w), &edges);
+		if(fabs(closed[w] - edges) > closed_worst)
+		{
+			closed_worst = fabs(closed[w] - edges);
+		}
+	}
+	rest();
+
+	/*Open loop at the duty giving the target speed unloaded*/
+	stop_rotat_speed_ctl();
+	uint8_t duty = (uint8_t)(255.0 * TARGET / FREE_SPEED);
+	rotational_motor_right();
+	set_rotational_motor_speed(duty);
+	for(int w = 0; w < WINDOWS; w++)
+	{
+		open[w] = run_window(load_at(w), &edges);
+		if(fabs(open[w] - edges) > open_worst)
+		{
+			open_worst = fabs(open[w] - edges);
+		}
+	}
+
+	report("Closed loop (PID)", closed, closed_worst);
+	report("Open loop (fixed duty)", open, open_worst);
+
+	/*Beyond the sampler, the measured speed aliases. Averaged over the
+	  second half of the run once the motor is at full speed.*/
+	set_rotational_motor_speed(MOTOR_MAX_PWM);
+	double true_sum = 0, meas_sum = 0;
+	for(int w = 0; w < FULL_WINDOWS; w++)
+	{
+		uint16_t vel = run_window(0, &edges);
+
+		if(w < FULL_WINDOWS / 2) continue;
+		true_sum += edges;
+		meas_sum += vel;
+	}
+	printf("Full duty, limit %d edges/window\n", ENCODER_MAX_VELOCITY);
+	printf("  true speed %.1f, measured %.1f edges/window\n",
+	       true_sum / (FULL_WINDOWS / 2), meas_sum / (FULL_WINDOWS / 2));
+	rest();
+
+	return 0;
+}
+/* End of speed_ctl_sim.c */
@@ -0,0 +1,63 @@
+#define F_CPU 8000000UL
+
+#include "speed_ctl.h"
+#include "encoder.h"
+#include "motor.h"
+#include "lcd_driver.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*Target speeds in edges per window*/
+#define SLOW_SPEED (ROTAT_DRILL_SPEED / 2)
+#define FAST_SPEED ROTAT_SPEED_MAX
+
+/*Windows between target changes (~5 seconds)*/
+#define STEP_WINDOWS 500
+
+/*From itoa.c*/
+extern char *num_to_str(int i);
+
+int main()
+{
+	uint16_t windows = 0;
+	uint8_t last_window;
+
+	sei();
+
+	initialize_LCD_driver();
+	init_encoders();
+	init_motor_drivers();
+	brake_rotational_motor();
+	start_encoders();
+
+	init_rotat_speed_ctl();
+	set_rotat_speed_target(SLOW_SPEED);
+	rotational_motor_right();
+	last_window = get_encoder_window();
+
+	/*Alternate between two speeds and display the measured speed, the
+	  controller itself runs from the encoder window tick*/
+	while(1)
+	{
+		if(get_encoder_window() == last_window) continue;
+		last_window = get_encoder_window();
+
+		if(++windows == STEP_WINDOWS)
+		{
+			windows = 0;
+			set_rotat_speed_target((get_rotat_speed_target() == SLOW_SPEED) ?
+			                       FAST_SPEED : SLOW_SPEED);
+		}
+
+		/*Refresh display every ~0.5 seconds*/
+		if((windows % 50) == 0)
+		{
+			lcd_erase();
+			lcd_puts(num_to_str(get_rotat_encoder_velocity()));
+			lcd_puts("/");
+			lcd_puts(num_to_str(get_rotat_speed_target()));
+		}
+	}
+
+	return 0;
+}
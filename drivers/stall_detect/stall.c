@@ -0,0 +1,295 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Implementation of the stall detector and jam recovery. See
+ *    stall.h for further details.
+ *
+ **************************************************************/
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include "stall.h"
+#include "trans_axis.h"
+#include "speed_ctl.h"
+#include "feed_ctl.h"
+#include "profile.h"
+#include "encoder.h"
+#include "motor.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 	          Global Variables              *
+ ********************************************/
+/*Auger stall detector*/
+static stall_detector auger_det;
+
+/*Recovery state*/
+static jam_state jam = JAM_IDLE;
+static uint8_t attempts = 0;
+static uint8_t state_windows = 0;
+
+/*Highest carriage position, where the final retract ends*/
+static int32_t jam_home = 0;
+
+/*DIR level the auger was drilling with when the jam was detected*/
+static bool drill_dir = true;
+
+/*Speed controller target to restore after reversing*/
+static uint16_t drill_speed = 0;
+
+/*Encoder windows handled by the detector and the recovery*/
+static uint8_t stall_window = 0;
+static uint8_t jam_window = 0;
+
+/********************************************
+ * 	    Static Function Prototypes          *
+ ********************************************/
+static void drive_auger(bool level);
+static void resume_auger(void);
+static void retract_to(int32_t pos);
+
+/*Turn the auger by DIR pin level*/
+static void drive_auger(bool level)
+{
+	if(level) rotational_motor_right();
+	else rotational_motor_left();
+}
+
+/*Hand the auger back to the speed controller in the drilling direction*/
+static void resume_auger(void)
+{
+	init_rotat_speed_ctl();
+	set_rotat_speed_target(drill_speed);
+	drive_auger(drill_dir);
+}
+
+/*Back the carriage off at the full feed rate, never above home*/
+static void retract_to(int32_t pos)
+{
+	if(pos < jam_home) pos = jam_home;
+	set_trans_axis_limits(TRANS_AXIS_MAX_VEL, TRANS_AXIS_MAX_ACC,
+	                      TRANS_AXIS_MAX_JERK);
+	trans_axis_move_to(pos);
+}
+
+/********************************************
+ * 		        API Functions               *
+ ********************************************/
+/*See stall.h for details*/
+void init_stall_detector(stall_detector *det, uint16_t min_vel,
+                         uint16_t max_current, uint8_t debounce)
+{
+	det->min_vel = min_vel;
+	det->max_current = max_current;
+	det->debounce = debounce;
+	clear_stall(det);
+}
+
+/*See stall.h for details*/
+bool update_stall_detector(stall_detector *det, uint16_t vel,
+                           uint16_t current, bool driving)
+{
+	if(det->stalled) return true;
+
+	bool stalling = (vel < det->min_vel) ||
+	                (det->max_current && (current > det->max_current));
+
+	if(!driving || !stalling)
+	{
+		det->count = 0;
+	}
+	else if(++det->count >= det->debounce)
+	{
+		det->stalled = true;
+	}
+
+	return det->stalled;
+}
+
+/*See stall.h for details*/
+void clear_stall(stall_detector *det)
+{
+	det->count = 0;
+	det->stalled = false;
+}
+
+/*See stall.h for details*/
+void init_jam_recovery(int32_t home)
+{
+	jam_home = home;
+	init_stall_detector(&auger_det, JAM_STALL_MIN_VEL, JAM_STALL_MAX_CURRENT,
+	                    JAM_STALL_DEBOUNCE);
+	jam = JAM_IDLE;
+	attempts = 0;
+	stall_window = get_encoder_window();
+}
+
+/*See stall.h for details*/
+void set_auger_stall_limits(uint16_t min_vel, uint16_t max_current,
+                            uint8_t debounce)
+{
+	init_stall_detector(&auger_det, min_vel, max_current, debounce);
+}
+
+/*See stall.h for details*/
+bool check_auger_stall(void)
+{
+	uint8_t window = get_encoder_window();
+
+	/*Run once per velocity window*/
+	if(window == stall_window) return auger_det.stalled;
+	stall_window = window;
+
+	uint16_t current = auger_det.max_current ? get_rotational_motor_current() : 0;
+	bool driving = (get_motor_direction(ROTAT_MOTOR) != MOTOR_DIR_OFF);
+
+	return update_stall_detector(&auger_det, get_rotat_encoder_velocity(),
+	                             current, driving);
+}
+
+/*See stall.h for details*/
+void start_jam_recovery(void)
+{
+	int8_t dir = get_motor_direction(ROTAT_MOTOR);
+
+	/*Keep the drilling direction of a previous attempt if braked*/
+	if(dir != MOTOR_DIR_OFF) drill_dir = (dir == MOTOR_DIR_HIGH);
+	if(jam == JAM_IDLE) drill_speed = get_rotat_speed_target();
+
+	clear_stall(&auger_det);
+	stop_trans_axis();
+	/*The auger is driven open loop until resume_auger()*/
+	stop_rotat_speed_ctl();
+	brake_rotational_motor();
+	jam_window = get_encoder_window();
+
+	if(attempts >= JAM_MAX_ATTEMPTS)
+	{
+		/*Give up and bring the auger back out of the hole*/
+		resume_auger();
+		retract_to(jam_home);
+		state_windows = JAM_BRAKE_WINDOWS;
+		jam = JAM_ABORT;
+		return;
+	}
+
+	attempts++;
+	state_windows = JAM_BRAKE_WINDOWS;
+	jam = JAM_BRAKE;
+}
+
+/*See stall.h for details*/
+jam_state update_jam_recovery(void)
+{
+	uint8_t window = get_encoder_window();
+	uint8_t ticks = window - jam_window;
+	jam_window = window;
+
+	switch(jam)
+	{
+		case JAM_BRAKE:
+			if(ticks < state_windows)
+			{
+				state_windows -= ticks;
+				break;
+			}
+			/*Unwind the auger against the drilling direction*/
+			set_rotational_motor_speed(JAM_REVERSE_DUTY);
+			drive_auger(!drill_dir);
+			state_windows = JAM_REVERSE_WINDOWS;
+			jam = JAM_REVERSE;
+			break;
+
+		case JAM_REVERSE:
+			if(ticks < state_windows)
+			{
+				state_windows -= ticks;
+				break;
+			}
+			/*Back off with the auger clearing soil, the ramp layer
+			  sequences the change of direction*/
+			resume_auger();
+			retract_to(get_trans_axis_position() - JAM_RETRACT_DIST);
+			state_windows = JAM_BRAKE_WINDOWS;
+			jam = JAM_RETRACT;
+			break;
+
+		case JAM_RETRACT:
+		case JAM_ABORT:
+			update_trans_axis();
+
+			/*A jam while backing off starts the next attempt, once the
+			  auger has had time to change direction*/
+			if(ticks < state_windows)
+			{
+				state_windows -= ticks;
+				clear_stall(&auger_det);
+			}
+			else
+			{
+				state_windows = 0;
+			}
+			if(check_auger_stall())
+			{
+				if(jam == JAM_ABORT)
+				{
+					/*Jammed on the way out, leave it to the operator*/
+					stop_trans_axis();
+					brake_rotational_motor();
+					jam = JAM_FAILED;
+				}
+				else
+				{
+					start_jam_recovery();
+				}
+				break;
+			}
+
+			if(!trans_axis_done()) break;
+
+			if(jam == JAM_ABORT)
+			{
+				brake_rotational_motor();
+				jam = JAM_FAILED;
+				break;
+			}
+			jam = JAM_IDLE;
+			return JAM_RESUME;
+
+		default:
+			break;
+	}
+
+	return jam;
+}
+
+/*See stall.h for details*/
+bool jam_recovery_active(void)
+{
+	return (jam != JAM_IDLE) && (jam != JAM_FAILED);
+}
+
+/*See stall.h for details*/
+uint8_t get_jam_attempts(void)
+{
+	return attempts;
+}
+
+/*See stall.h for details*/
+uint16_t get_jam_feed_limit(void)
+{
+	uint16_t limit = FEED_MAX_VEL >> attempts;
+
+	return (limit < FEED_MIN_VEL) ? FEED_MIN_VEL : limit;
+}
+
+/*See stall.h for details*/
+void reset_jam_recovery(void)
+{
+	attempts = 0;
+	clear_stall(&auger_det);
+}
+/* End of stall.c */
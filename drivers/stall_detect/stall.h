@@ -0,0 +1,200 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Stall detection and automatic jam recovery for the auger.
+ *
+ *    A stall detector flags a motor as stalled when it is being
+ *    driven but its encoder velocity stays below a threshold, or
+ *    its current stays above a threshold, for a number of
+ *    consecutive velocity windows. Detectors are plain structs so
+ *    one can be kept per motor.
+ *
+ *    The jam recovery state machine frees a bound auger without
+ *    operator input: both motors are braked, the auger is briefly
+ *    reversed, the carriage retracts a short distance with the
+ *    auger turning in the drilling direction, and the caller then
+ *    retries the descent with a reduced feed rate. After
+ *    JAM_MAX_ATTEMPTS failed attempts the carriage is retracted to
+ *    the home position given to init_jam_recovery() instead, or
+ *    both motors are left braked if the auger jams on the way out.
+ *    No retract goes above the home position. While recovery is
+ *    active it owns both motors and runs the translational axis
+ *    loop itself, and the auger speed controller is stopped while
+ *    the auger is reversed. All steps are timed in encoder velocity
+ *    windows.
+ *
+ **************************************************************/
+
+#ifndef STALL_H_
+#define STALL_H_
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "speed_ctl.h"
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Default auger stall thresholds*/
+#define JAM_STALL_MIN_VEL     (ROTAT_DRILL_SPEED / 5) //Edges per window (20%)
+#define JAM_STALL_MAX_CURRENT 0                       //mA, 0 ignores current
+#define JAM_STALL_DEBOUNCE    10                      //Windows (100ms)
+
+/*Recovery sequence*/
+#define JAM_MAX_ATTEMPTS    3
+#define JAM_BRAKE_WINDOWS   20   //200ms
+#define JAM_REVERSE_WINDOWS 50   //500ms
+#define JAM_REVERSE_DUTY    128  //50%
+#define JAM_RETRACT_DIST    4000 //Counts
+
+/********************************************
+ * 		          Typedefs                  *
+ ********************************************/
+/*Stall Detector State*/
+typedef struct {
+	uint16_t min_vel;     //Velocity below which the motor is stalling
+	uint16_t max_current; //Current above which the motor is stalling (0 = off)
+	uint8_t debounce;     //Consecutive stalling windows before a stall
+	uint8_t count;        //Consecutive stalling windows seen
+	bool stalled;         //Stall latched
+}stall_detector;
+
+/*Jam Recovery States*/
+typedef enum {
+	JAM_IDLE    = 0, //No recovery in progress
+	JAM_BRAKE   = 1, //Both motors braked
+	JAM_REVERSE = 2, //Auger turning against the drilling direction
+	JAM_RETRACT = 3, //Carriage backing off with the auger turning
+	JAM_RESUME  = 4, //Recovered, the caller should retry the descent
+	JAM_ABORT   = 5, //Out of attempts, retracting to the home position
+	JAM_FAILED  = 6, //Out of attempts and retracted
+}jam_state;
+
+/********************************************
+ * 		      Function Prototypes           *
+ ********************************************/
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Initializes a stall detector. A "max_current" of 0 disables
+ *    the current threshold.
+ *
+ **************************************************************/
+void init_stall_detector(stall_detector *det, uint16_t min_vel,
+                         uint16_t max_current, uint8_t debounce);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Feeds one velocity window of measurements to a detector and
+ *    returns true once a stall is latched. Windows in which the
+ *    motor is not being driven reset the debounce count. A latched
+ *    stall is held until clear_stall() is called.
+ *
+ **************************************************************/
+bool update_stall_detector(stall_detector *det, uint16_t vel,
+                           uint16_t current, bool driving);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Clears a latched stall and the debounce count.
+ *
+ **************************************************************/
+void clear_stall(stall_detector *det);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Initializes the auger stall detector with the default
+ *    thresholds and resets the recovery attempt count. "home" is
+ *    the carriage position retracts never go above and the final
+ *    retract returns to, e.g. the starting position above the
+ *    soil. The encoder and motor drivers, translational axis and
+ *    speed controller must be initialized first.
+ *
+ **************************************************************/
+void init_jam_recovery(int32_t home);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Changes the auger stall thresholds, see init_stall_detector().
+ *
+ **************************************************************/
+void set_auger_stall_limits(uint16_t min_vel, uint16_t max_current,
+                            uint8_t debounce);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Runs the auger stall detector if a new encoder velocity window
+ *    has completed since the last check. Returns true if the auger
+ *    has stalled.
+ *
+ **************************************************************/
+bool check_auger_stall(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Starts a recovery attempt from the current carriage position,
+ *    or the retract to the home position once JAM_MAX_ATTEMPTS
+ *    have been used.
+ *
+ **************************************************************/
+void start_jam_recovery(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Advances the recovery and runs the axis loop. Must be called
+ *    from the application loop in place of update_trans_axis()
+ *    while recovery is active. Returns JAM_RESUME once
+ *    when an attempt completes, after which the state is JAM_IDLE.
+ *
+ **************************************************************/
+jam_state update_jam_recovery(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns true while a recovery owns the motors.
+ *
+ **************************************************************/
+bool jam_recovery_active(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the number of recovery attempts made since
+ *    init_jam_recovery() or reset_jam_recovery().
+ *
+ **************************************************************/
+uint8_t get_jam_attempts(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the feed rate limit to retry the descent with, in
+ *    counts per window. Halved for every attempt made.
+ *
+ **************************************************************/
+uint16_t get_jam_feed_limit(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Clears the attempt count, e.g. once the target depth has been
+ *    reached.
+ *
+ **************************************************************/
+void reset_jam_recovery(void);
+
+#endif
+/* End of stall.h */
@@ -0,0 +1,163 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host simulation of the auger jam recovery. Runs stall.c
+ *    against stand-ins for the motors, speed controller and
+ *    translational axis, one encoder velocity window per step,
+ *    and prints each change of recovery state.
+ *
+ *    The auger turns at the speed target unless it is jammed, and
+ *    only jams while the carriage is descending. Axis moves take a
+ *    fixed number of windows. Two cases are run:
+ *    a jam that clears after the first recovery attempt, and one
+ *    that never clears, which ends in the retract to the home
+ *    position above the soil surface.
+ *
+ *      make sim
+ *
+ **************************************************************/
+
+#include "stall.h"
+#include "motor.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*Model*/
+#define AUGER_SPEED  ROTAT_DRILL_SPEED        //Edges per window when free
+#define JAMMED_SPEED (ROTAT_DRILL_SPEED / 20) //Edges per window when jammed
+#define MOVE_WINDOWS 30    //Length of every axis move
+#define DRILL_DEPTH  32000 //Descent target (counts)
+#define START_DEPTH  10000 //Carriage position when the jam is hit
+#define HOME_POS     -1000 //Starting position, above the soil at zero
+
+/*Longest run simulated (windows)*/
+#define RUN_WINDOWS 3000
+
+/*Model state*/
+static uint8_t window = 0;
+static int8_t auger_dir = MOTOR_DIR_OFF;
+static bool jammed = false;
+static bool axis_done = true;
+static int axis_windows = 0;
+static int32_t axis_pos = 0;
+static int32_t axis_target = 0;
+
+/*Encoder, motor, speed controller and axis stand-ins*/
+uint8_t get_encoder_window(void) { return window; }
+int8_t get_motor_direction(motor_id id) { (void)id; return auger_dir; }
+uint16_t get_rotational_motor_current(void) { return 0; }
+uint16_t get_rotat_speed_target(void) { return AUGER_SPEED; }
+
+uint16_t get_rotat_encoder_velocity(void)
+{
+	/*The auger only binds while the carriage feeds it down*/
+	bool descending = !axis_done && (axis_target > axis_pos);
+
+	if(auger_dir == MOTOR_DIR_OFF) return 0;
+	return (jammed && descending) ? JAMMED_SPEED : AUGER_SPEED;
+}
+
+void init_rotat_speed_ctl(void) {}
+void stop_rotat_speed_ctl(void) {}
+void set_rotat_speed_target(uint16_t target) { (void)target; }
+void set_rotational_motor_speed(uint8_t speed) { (void)speed; }
+void rotational_motor_right(void) { auger_dir = MOTOR_DIR_HIGH; }
+void rotational_motor_left(void) { auger_dir = MOTOR_DIR_LOW; }
+void brake_rotational_motor(void) { auger_dir = MOTOR_DIR_OFF; }
+
+void set_trans_axis_limits(uint16_t vel, uint16_t acc, uint16_t jerk)
+{
+	(void)vel;
+	(void)acc;
+	(void)jerk;
+}
+
+void trans_axis_move_to(int32_t target)
+{
+	axis_target = target;
+	axis_windows = 0;
+	axis_done = false;
+}
+
+bool update_trans_axis(void)
+{
+	if(!axis_done && (++axis_windows >= MOVE_WINDOWS))
+	{
+		axis_pos = axis_target;
+		axis_done = true;
+	}
+	return true;
+}
+
+void stop_trans_axis(void) { axis_done = true; }
+bool trans_axis_done(void) { return axis_done; }
+int32_t get_trans_axis_position(void) { return axis_pos; }
+
+static const char *state_name(jam_state state)
+{
+	static const char *names[] = {"IDLE", "BRAKE", "REVERSE", "RETRACT",
+	                              "RESUME", "ABORT", "FAILED"};
+	return names[state];
+}
+
+/*Drills from START_DEPTH with the auger jammed until "clear_after"
+  recovery attempts have been made (0 never clears)*/
+static void run_jam(uint8_t clear_after)
+{
+	jam_state last = JAM_IDLE;
+
+	axis_pos = START_DEPTH;
+	jammed = true;
+	rotational_motor_right();
+	trans_axis_move_to(DRILL_DEPTH);
+	init_jam_recovery(HOME_POS);
+
+	for(int t = 0; t < RUN_WINDOWS; t++)
+	{
+		window++;
+
+		if(!jam_recovery_active())
+		{
+			update_trans_axis();
+			if(check_auger_stall())
+			{
+				printf("  window %4d: stall at %ld\n", t, (long)axis_pos);
+				start_jam_recovery();
+			}
+			continue;
+		}
+
+		jam_state state = update_jam_recovery();
+		if(state != last)
+		{
+			printf("  window %4d: %-7s attempt %u, feed limit %3u, "
+			       "carriage %ld\n", t, state_name(state),
+			       get_jam_attempts(), get_jam_feed_limit(), (long)axis_pos);
+			last = state;
+		}
+
+		if(state == JAM_RESUME)
+		{
+			if(clear_after && (get_jam_attempts() >= clear_after)) jammed = false;
+			trans_axis_move_to(DRILL_DEPTH);
+		}
+		if(state == JAM_FAILED) break;
+	}
+
+	printf("  %s, carriage %ld, auger %s\n",
+	       jam_recovery_active() ? "recovering" : "done", (long)axis_pos,
+	       (auger_dir == MOTOR_DIR_OFF) ? "braked" : "turning");
+}
+
+int main(void)
+{
+	printf("Jam cleared by the first attempt\n");
+	run_jam(1);
+	printf("Persistent jam\n");
+	run_jam(0);
+
+	return 0;
+}
+/* End of stall_sim.c */
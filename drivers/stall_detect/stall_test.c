@@ -0,0 +1,90 @@
+#define F_CPU 8000000UL
+
+#include "stall.h"
+#include "feed_ctl.h"
+#include "speed_ctl.h"
+#include "trans_axis.h"
+#include "encoder.h"
+#include "motor.h"
+#include "lcd_driver.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+/*Auger speed in edges per window*/
+#define AUGER_SPEED ROTAT_DRILL_SPEED
+
+/*Test descent in encoder counts*/
+#define TEST_DIST 32000L
+
+/*From itoa.c*/
+extern char *num_to_str(int i);
+
+/*Show the recovery state and attempt count*/
+static void show_state(jam_state jam)
+{
+	lcd_erase();
+	lcd_puts("S:");
+	lcd_puts(num_to_str(jam));
+	lcd_puts(" A:");
+	lcd_puts(num_to_str(get_jam_attempts()));
+}
+
+int main()
+{
+	jam_state shown = JAM_IDLE;
+
+	sei();
+
+	initialize_LCD_driver();
+	init_encoders();
+	init_motor_drivers();
+	brake_rotational_motor();
+	brake_translational_motor();
+	start_encoders();
+
+	init_trans_axis();
+	init_rotat_speed_ctl();
+	set_rotat_speed_target(AUGER_SPEED);
+	init_feed_ctl(FEED_LOAD_DROOP, FEED_DROOP_TARGET);
+	init_jam_recovery(0); //Retracts end where the test started
+	show_state(shown);
+
+	/*Drill down, hold the auger by hand to trigger a recovery*/
+	rotational_motor_right();
+	trans_axis_move_to(TEST_DIST);
+
+	while(!trans_axis_done() || jam_recovery_active())
+	{
+		jam_state jam = JAM_IDLE;
+
+		if(jam_recovery_active())
+		{
+			jam = update_jam_recovery();
+			if(jam == JAM_RESUME)
+			{
+				init_feed_ctl(FEED_LOAD_DROOP, FEED_DROOP_TARGET);
+				set_feed_limits(FEED_MIN_VEL, get_jam_feed_limit());
+				trans_axis_move_to(TEST_DIST);
+			}
+		}
+		else
+		{
+			update_feed_ctl();
+			update_trans_axis();
+			if(check_auger_stall()) start_jam_recovery();
+		}
+
+		if(jam != shown)
+		{
+			shown = jam;
+			show_state(jam);
+		}
+	}
+
+	brake_rotational_motor();
+	stop_trans_axis();
+
+	while(1);
+
+	return 0;
+}
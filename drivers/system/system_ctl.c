@@ -7,7 +7,41 @@
  *    are three possible input pulse widths that correspond to three
  *    unique system states: OFF, ENABLE, and MANUAL_OVERRIDE.
  *    This driver uses pin change interrupt 19 to monitor the
- *    system control state continuously. 
+ *    system control state continuously. Each pulse is decoded in
+ *    the interrupt and the result is cached, so the state can be
+ *    read without waiting for the next pulse.
+ *
+ *    Timer/Counter1 runs freely at 1MHz and is never reset. Both
+ *    pulse edges are timestamped and the width is the difference,
+ *    so the timer can be shared with other modules. The timestamps
+ *    are taken in the pin change interrupt, the board has no free
+ *    input capture pin (see system_ctl.h).
+ *
+ *    Each pulse is classified with per-state hysteresis: a pulse
+ *    must fall in a narrow band to enter a state but only in a
+ *    wider band to hold the current one. The classified pulses
+ *    then vote, and the state only changes when N of the last M
+ *    pulses agree. If no pulse confirms the state within the
+ *    signal loss timeout the failsafe state is reported instead.
+ *    Each change of the voted state is queued for the event API.
+ *
+ *    A second, proportional RC channel on PC4 (pin change
+ *    interrupt 20) shares the pin change interrupt and timestamps.
+ *    Its pulse width is scaled to 0..255 with a deadband at both
+ *    ends of the stick travel, smoothed with a first order filter,
+ *    and only updated when the filtered value moves by more than
+ *    the change deadband.
+ *
+ *    Building with SYS_CNTL_PPM defined reads a PPM sum signal with
+ *    up to SYS_PPM_MAX_CH channels on the system control input
+ *    instead. Channels are timed between rising edges and a gap
+ *    longer than PPM_SYNC_MIN marks the start of a frame. A frame
+ *    is only published when it has the same number of channels as
+ *    the one before, then the state and proportional channels are
+ *    passed to the same filters as the separate inputs. PC4 is not
+ *    used in this mode. PPM edges are timestamped in the pin change
+ *    interrupt like the separate pulses, see system_ctl.h for the
+ *    jitter this adds.
  *
  **************************************************************/
 
@@ -17,6 +51,7 @@
 #include "system_ctl.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -34,12 +69,19 @@
 /*System Control Input Pin Location*/
 #define SYS_CNTL 3
 
+/*Proportional Channel Input Port and Pin Location*/
+#define SYS_PROP_PORT C
+#define SYS_PROP 4
+
 /*Pin Change Interrupt PortC*/
 #define PCIE2 2
 
 /*Pin Change Interrupt 19*/
 #define PCINT19 3
 
+/*Pin Change Interrupt 20*/
+#define PCINT20 4
+
 /*Timer1 Waveform Generation*/
 #define WGM13 4
 #define WGM12 3
@@ -51,24 +93,65 @@
 #define CS11 1
 #define CS10 0
 
-/*System Control Pulse Tolerance Factors*/
-#define TOLERANCE 15
+/*Timer1 Interrupt Enable and Flag Bits*/
+#define TOIE1 0
+#define TOV1  0
+
+/*Timer1 ticks per millisecond*/
+#define TICKS_PER_MS 1000UL
 
-/*System Control Pulse Width Definitions
+/*Timer1 overflows before the state age saturates (65.5s)*/
+#define AGE_MAX_OVF 1000
+
+/*System Control Pulse Width Definitions (us)
  *	   Base Values	          */
 #define SYS_OFF		    	1000
 #define SYS_ENABLE	    	2000
 #define SYS_MANUAL_OVERRIDE	1500
 
-/*        Upper Bound Values	*/
-#define SYS_OFF_UPPER		      (TOLERANCE + SYS_OFF)		
-#define SYS_ENABLE_UPPER          (TOLERANCE + SYS_ENABLE)
-#define SYS_MANUAL_OVERRIDE_UPPER (TOLERANCE + SYS_MANUAL_OVERRIDE)
+/*  Half Width of the Band to Enter a State  */
+#define SYS_OFF_ENTER		      40
+#define SYS_ENABLE_ENTER          40
+#define SYS_MANUAL_OVERRIDE_ENTER 60
+
+/*  Half Width of the Band to Hold a State   */
+#define SYS_OFF_HOLD		      150
+#define SYS_ENABLE_HOLD           150
+#define SYS_MANUAL_OVERRIDE_HOLD  150
 
-/*      Lower Bound Values       */
-#define SYS_OFF_LOWER		      (SYS_OFF - TOLERANCE)		
-#define SYS_ENABLE_LOWER          (SYS_ENABLE - TOLERANCE)
-#define SYS_MANUAL_OVERRIDE_LOWER (SYS_MANUAL_OVERRIDE - TOLERANCE)
+/*Proportional Channel Pulse Widths (us)*/
+#define PROP_MIN       1000 //Value 0
+#define PROP_MAX       2000 //Value 255
+#define PROP_LOWEST    900  //Shorter pulses are rejected
+#define PROP_HIGHEST   2100 //Longer pulses are rejected
+#define PROP_END_BAND  30   //Travel held at 0 or 255 at each end
+
+/*Proportional Channel Filter, Fraction of Each Step is 1/2^n*/
+#define PROP_SMOOTH 2
+
+/*PPM Gap Marking the Start of a Frame (us)*/
+#define PPM_SYNC_MIN 3000
+
+/*Number of Pulse Width Bands*/
+#define NUM_BANDS 3
+
+/*Event Queue Index Mask*/
+#define EVENT_MASK (SYS_EVENT_QUEUE - 1)
+
+#if (SYS_EVENT_QUEUE & EVENT_MASK) != 0
+#error "SYS_EVENT_QUEUE must be a power of two"
+#endif
+
+/********************************************
+ * 		          Structs                   *
+ ********************************************/
+/*Pulse Width Band of a System State*/
+typedef struct {
+	int8_t state;    //State reported for the band
+	uint16_t centre; //Nominal pulse width
+	uint16_t enter;  //Half width to enter the state
+	uint16_t hold;   //Half width to remain in the state
+}pulse_band;
 
 /********************************************
  * 	          Global Variables              *
@@ -76,21 +159,106 @@
 /*Store Width of System Control Input Pulse*/
 volatile uint16_t sys_ctl_pulse_width = 0;
 
-/*Flag to Indicate When New Control Input is Available*/
+/*Flag to Indicate a Control Pulse has been Decoded*/
 volatile bool data_ready = false;
 
+/*State Decoded from the Last Complete Pulse*/
+static volatile int8_t sys_state = SYS_UNRECOGNIZED_STATE;
+
+/*Pulse Width Bands of the System States*/
+static const pulse_band bands[NUM_BANDS] = {
+	{SYS_OFF_STATE, SYS_OFF, SYS_OFF_ENTER, SYS_OFF_HOLD},
+	{SYS_ENABLE_STATE, SYS_ENABLE, SYS_ENABLE_ENTER, SYS_ENABLE_HOLD},
+	{SYS_MANUAL_OVERRIDE_STATE, SYS_MANUAL_OVERRIDE,
+	 SYS_MANUAL_OVERRIDE_ENTER, SYS_MANUAL_OVERRIDE_HOLD}
+};
+
+/*Classified States of the Last Pulses, Oldest Overwritten*/
+static int8_t votes[SYS_VOTE_MAX];
+static uint8_t vote_pos = 0;
+
+/*Voting Filter, N of the Last M Pulses*/
+static uint8_t vote_n = SYS_VOTE_N;
+static uint8_t vote_m = SYS_VOTE_M;
+
+/*Signal Loss Behaviour*/
+static int8_t failsafe_state = SYS_FAILSAFE_STATE;
+static uint32_t loss_ticks = SYS_LOSS_TIMEOUT * TICKS_PER_MS;
+
+/*Voted State Changes Awaiting get_sys_cntl_event()*/
+static volatile int8_t event_queue[SYS_EVENT_QUEUE];
+static volatile uint8_t event_head = 0;
+static volatile uint8_t event_tail = 0;
+
+/*State Reported by the Last Event and Signal Loss Reported*/
+static int8_t event_state = SYS_UNRECOGNIZED_STATE;
+static bool loss_reported = false;
+
+/*Number of Pulses Decoded, Wraps Around*/
+static volatile uint8_t frame_seq = 0;
+
+/*Upper 16 bits of the Timer1 time*/
+static volatile uint16_t time_hi = 0;
+
+/*Timer1 Overflows Since the State was Last Confirmed*/
+static volatile uint16_t idle_ovf = 0;
+
+#ifndef SYS_CNTL_PPM
+/*Timestamp of the Last Rising Edge*/
+static uint32_t rise_time = 0;
+#endif
+
+/*Timestamp of the Last Pulse Confirming the State*/
+static volatile uint32_t valid_time = 0;
+
+/*Port C Input Levels at the Last Pin Change*/
+static uint8_t last_pins = 0;
+
+/*Proportional Channel State*/
+#ifndef SYS_CNTL_PPM
+static uint32_t prop_rise = 0;               //Last rising edge
+#endif
+static volatile uint32_t prop_time = 0;      //Last valid pulse
+static volatile uint16_t prop_idle_ovf = AGE_MAX_OVF;
+static uint16_t prop_filter = 0;             //Filtered value (Q8)
+static volatile uint8_t prop_value = 0;      //Reported value
+static uint8_t prop_deadband = SYS_PROP_DEADBAND;
+
+#ifdef SYS_CNTL_PPM
+/*PPM Decoder State*/
+static uint32_t ppm_last = 0;                //Last rising edge
+static uint16_t ppm_work[SYS_PPM_MAX_CH];    //Frame being received
+static uint8_t ppm_index = 0;                //Next channel in the frame
+static uint8_t ppm_prev_count = 0;           //Channels in the last frame
+static bool ppm_framing = false;             //Frame start has been seen
+static volatile uint16_t ppm_width[SYS_PPM_MAX_CH]; //Published frame
+static volatile uint8_t ppm_count = 0;       //Channels published
+static volatile uint8_t ppm_frame = 0;       //Frames published
+static volatile bool ppm_synced = false;     //Frames are consistent
+static volatile uint32_t ppm_time = 0;       //Last published frame
+static volatile uint16_t ppm_idle_ovf = AGE_MAX_OVF;
+#endif
+
 /********************************************
  * 	    Static Function Prototypes          *
  ********************************************/
-static bool rising_edge(void);
 static void start_counter(void);
-static void stop_counter(void);
-
-/*Determines if a rising edge occurs*/
-static bool rising_edge(void)
-{
-	return (PIN(SYS_CNTL_PORT) & (1 << SYS_CNTL));
-}
+static uint32_t extend_time(uint16_t ticks);
+static void state_pulse(uint32_t width, uint32_t stamp);
+static int8_t decode_pulse(uint16_t width, int8_t current);
+static void clear_votes(void);
+static void vote(int8_t state);
+static bool signal_lost(uint32_t elapsed, uint16_t idle);
+static void queue_state(int8_t state);
+static void prop_pulse(uint32_t width, uint32_t stamp);
+static uint8_t scale_prop(uint16_t width);
+#ifdef SYS_CNTL_PPM
+static void ppm_edge(uint32_t stamp);
+static bool ppm_lost(void);
+#else
+static void pulse_edge(bool rising, uint32_t stamp);
+static void prop_edge(bool rising, uint32_t stamp);
+#endif
 
 /*Turn on Timer/Counter1*/
 static void start_counter(void)
@@ -99,39 +267,295 @@ static void start_counter(void)
 	TCCR1B |= (1 << CS11); //1 MHz clk
 }
 
-/*Disable Timer/Counter1*/
-static void stop_counter(void)
+/*Extends a Timer1 value to 32 bits, interrupts must be off*/
+static uint32_t extend_time(uint16_t ticks)
+{
+	uint16_t hi = time_hi;
+
+	//An overflow is pending if the counter wrapped after the
+	//last overflow interrupt and before "ticks" was read
+	if((TIFR1 & (1 << TOV1)) && (ticks < 0x8000)) hi++;
+
+	return ((uint32_t)hi << 16) | ticks;
+}
+
+/*Classifies and votes a control pulse*/
+static void state_pulse(uint32_t width, uint32_t stamp)
+{
+	//Start voting afresh after the signal was lost
+	if(data_ready && signal_lost(stamp - valid_time, idle_ovf))
+	{
+		clear_votes();
+		sys_state = SYS_UNRECOGNIZED_STATE;
+		data_ready = false;
+		queue_state(SYS_UNRECOGNIZED_STATE);
+	}
+
+	//Pulses longer than one timer period are invalid
+	sys_ctl_pulse_width = (width > UINT16_MAX) ?
+	                      UINT16_MAX : (uint16_t)width;
+	int8_t state = decode_pulse(sys_ctl_pulse_width, sys_state);
+	vote(state);
+
+	//Only pulses agreeing with the voted state keep the link alive
+	if(data_ready && (state == sys_state))
+	{
+		valid_time = stamp;
+		idle_ovf = 0;
+	}
+	frame_seq++;
+}
+
+/*Converts a pulse width to a system state*/
+static int8_t decode_pulse(uint16_t width, int8_t current)
+{
+	//Wider band while holding the current state
+	for(uint8_t i = 0; i < NUM_BANDS; i++)
+	{
+		const pulse_band *b = &bands[i];
+
+		if((b->state == current) &&
+		   (width >= (b->centre - b->hold)) &&
+		   (width <= (b->centre + b->hold)))
+		{
+			return current;
+		}
+	}
+
+	//Narrow band to enter a new state
+	for(uint8_t i = 0; i < NUM_BANDS; i++)
+	{
+		const pulse_band *b = &bands[i];
+
+		if((width >= (b->centre - b->enter)) &&
+		   (width <= (b->centre + b->enter)))
+		{
+			return b->state;
+		}
+	}
+
+	return SYS_UNRECOGNIZED_STATE;
+}
+
+/*Empties the voting window*/
+static void clear_votes(void)
+{
+	for(uint8_t i = 0; i < SYS_VOTE_MAX; i++)
+	{
+		votes[i] = SYS_UNRECOGNIZED_STATE;
+	}
+	vote_pos = 0;
+}
+
+/*Adds a pulse to the voting window and updates the voted state*/
+static void vote(int8_t state)
+{
+	uint8_t count = 0;
+
+	votes[vote_pos] = state;
+	if(++vote_pos >= vote_m) vote_pos = 0;
+
+	//Unrecognized pulses never win a vote
+	if(state == SYS_UNRECOGNIZED_STATE) return;
+
+	for(uint8_t i = 0; i < vote_m; i++)
+	{
+		if(votes[i] == state) count++;
+	}
+
+	if(count >= vote_n)
+	{
+		if(!data_ready || (state != sys_state)) queue_state(state);
+		sys_state = state;
+		data_ready = true;
+	}
+}
+
+/*Adds a voted state change to the event queue*/
+static void queue_state(int8_t state)
+{
+	event_queue[event_head] = state;
+	event_head = (event_head + 1) & EVENT_MASK;
+
+	//Discard the oldest change when full
+	if(event_head == event_tail) event_tail = (event_tail + 1) & EVENT_MASK;
+}
+
+/*Determines if the state has gone unconfirmed for too long*/
+static bool signal_lost(uint32_t elapsed, uint16_t idle)
+{
+	return (idle >= AGE_MAX_OVF) || (elapsed > loss_ticks);
+}
+
+/*Filters a proportional channel pulse*/
+static void prop_pulse(uint32_t width, uint32_t stamp)
+{
+	if((width < PROP_LOWEST) || (width > PROP_HIGHEST)) return;
+
+	uint16_t raw = (uint16_t)scale_prop((uint16_t)width) << 8;
+
+	//Start from the first pulse after a loss rather than ramping
+	if(signal_lost(stamp - prop_time, prop_idle_ovf))
+	{
+		prop_filter = raw;
+	}
+	else
+	{
+		prop_filter += ((int32_t)raw - prop_filter) >> PROP_SMOOTH;
+	}
+	prop_time = stamp;
+	prop_idle_ovf = 0;
+
+	//Hold the value unless it moves past the deadband or an end stop
+	uint8_t value = (prop_filter + 0x80) >> 8;
+	int16_t change = (int16_t)value - prop_value;
+	if((change > prop_deadband) || (change < -prop_deadband) ||
+	   (value == 0) || (value == UINT8_MAX))
+	{
+		prop_value = value;
+	}
+}
+
+#ifdef SYS_CNTL_PPM
+/*Times a PPM channel from the previous rising edge*/
+static void ppm_edge(uint32_t stamp)
+{
+	uint32_t width = stamp - ppm_last;
+
+	ppm_last = stamp;
+
+	//A long gap ends the frame in progress and starts the next
+	if(width >= PPM_SYNC_MIN)
+	{
+		if(ppm_framing && ppm_index)
+		{
+			ppm_synced = (ppm_index == ppm_prev_count);
+			ppm_prev_count = ppm_index;
+
+			if(ppm_synced)
+			{
+				for(uint8_t i = 0; i < ppm_index; i++)
+				{
+					ppm_width[i] = ppm_work[i];
+				}
+				ppm_count = ppm_index;
+				ppm_time = stamp;
+				ppm_idle_ovf = 0;
+				ppm_frame++;
+
+				if(ppm_index > SYS_PPM_STATE_CH)
+				{
+					state_pulse(ppm_work[SYS_PPM_STATE_CH], stamp);
+				}
+				if(ppm_index > SYS_PPM_PROP_CH)
+				{
+					prop_pulse(ppm_work[SYS_PPM_PROP_CH], stamp);
+				}
+			}
+		}
+		ppm_framing = true;
+		ppm_index = 0;
+		return;
+	}
+
+	if(!ppm_framing) return;
+
+	//Drop the frame on a glitch and wait for the next gap
+	if((width < PROP_LOWEST) || (width > PROP_HIGHEST) ||
+	   (ppm_index >= SYS_PPM_MAX_CH))
+	{
+		ppm_framing = false;
+		ppm_synced = false;
+		return;
+	}
+
+	ppm_work[ppm_index++] = (uint16_t)width;
+}
+
+/*Determines if no frame has been published for too long*/
+static bool ppm_lost(void)
+{
+	return signal_lost(extend_time(TCNT1) - ppm_time, ppm_idle_ovf);
+}
+#else
+/*Records an edge of the control pulse*/
+static void pulse_edge(bool rising, uint32_t stamp)
+{
+	if(rising)
+	{
+		//New input being received
+		rise_time = stamp;
+	}
+
+	else
+	{
+		state_pulse(stamp - rise_time, stamp);
+	}
+}
+
+/*Records an edge of the proportional channel*/
+static void prop_edge(bool rising, uint32_t stamp)
+{
+	if(rising)
+	{
+		prop_rise = stamp;
+	}
+
+	else
+	{
+		prop_pulse(stamp - prop_rise, stamp);
+	}
+}
+#endif
+
+/*Converts a proportional pulse width to 0..255*/
+static uint8_t scale_prop(uint16_t width)
 {
-	TCCR1B &= ~((1 << CS12) | (1 << CS11) | (1 << CS10));
+	if(width <= (PROP_MIN + PROP_END_BAND)) return 0;
+	if(width >= (PROP_MAX - PROP_END_BAND)) return UINT8_MAX;
+
+	return (uint8_t)(((uint32_t)(width - PROP_MIN - PROP_END_BAND) *
+	                  UINT8_MAX) / (PROP_MAX - PROP_MIN - 2 * PROP_END_BAND));
 }
 
 /********************************************
  * 	     Interrupt Service Routines         *
  ********************************************/
-/*Determines width of input control pulse*/
+/*Timestamps an edge of the control or proportional pulse*/
 ISR(PCINT2_vect)
-{	
-	//disable interrupts
-	cli();
-	
-	if(rising_edge())
+{
+	uint16_t now = TCNT1;
+	uint8_t pins = PIN(SYS_PROP_PORT);
+	uint8_t changed = pins ^ last_pins;
+	uint32_t stamp = extend_time(now);
+
+	last_pins = pins;
+
+	if(changed & (1 << SYS_CNTL))
 	{
-		//New input being received
-		data_ready = false;
-		TCNT1 = 0;
-		sys_ctl_pulse_width = 0;
-		start_counter();
+#ifdef SYS_CNTL_PPM
+		if(pins & (1 << SYS_CNTL)) ppm_edge(stamp);
+#else
+		pulse_edge(pins & (1 << SYS_CNTL), stamp);
+#endif
 	}
-	
-	else
+#ifndef SYS_CNTL_PPM
+	if(changed & (1 << SYS_PROP))
 	{
-		stop_counter();
-		sys_ctl_pulse_width = TCNT1;
-		data_ready = true;
-	}  
-	
-	//restore interrupts
-	sei();
+		prop_edge(pins & (1 << SYS_PROP), stamp);
+	}
+#endif
+}
+
+/*Extends Timer1 and counts the time without a valid pulse*/
+ISR(TIMER1_OVF_vect)
+{
+	time_hi++;
+	if(idle_ovf < AGE_MAX_OVF) idle_ovf++;
+	if(prop_idle_ovf < AGE_MAX_OVF) prop_idle_ovf++;
+#ifdef SYS_CNTL_PPM
+	if(ppm_idle_ovf < AGE_MAX_OVF) ppm_idle_ovf++;
+#endif
 }
 
 /********************************************
@@ -140,58 +564,296 @@ ISR(PCINT2_vect)
 /*See system_ctl.h for details*/
 void init_system_cntl(void)
 {
+	clear_votes();
 	sei();
 	//Configure system control pin as input
-	DDR(SYS_CNTL_PORT) &= ~(1 << SYS_CNTL); 
-	//Enable pin change interrupts on PortA
+	DDR(SYS_CNTL_PORT) &= ~(1 << SYS_CNTL);
+	last_pins = PIN(SYS_PROP_PORT);
+	//Enable pin change interrupts on PortC
 	PCICR |= (1 << PCIE2);
 	//Eanble pin change interrupt for Enable input
 	PCMSK2 |= (1 << PCINT19);
+#ifndef SYS_CNTL_PPM
+	//Configure the proportional input, PPM carries it otherwise
+	DDR(SYS_PROP_PORT) &= ~(1 << SYS_PROP);
+	PCICR |= (1 << PCIE2);
+	PCMSK2 |= (1 << PCINT20);
+#endif
 	//Set Timer1 to normal mode
 	TCCR1A &= ~((1 << WGM11) | (1 << WGM10));
 	TCCR1B &= ~((1 << WGM13) | (1 << WGM12));
+	//Run Timer1 continuously, it is never reset
+	TIFR1 = (1 << TOV1);
+	TIMSK1 |= (1 << TOIE1);
+	start_counter();
+	//The signal loss timeout runs from initialization
+	valid_time = get_sys_cntl_time();
 }
 
 /*See system_ctl.h for details*/
-int8_t get_sys_cntl_state(void)
+void set_sys_cntl_filter(uint8_t n, uint8_t m)
 {
-	int8_t sys_cntl_state = SYS_UNRECOGNIZED_STATE;
-	//Wait for new input to be read
-	while(!data_ready);
-	
-	//Disable interrupts
-	cli();
+	if(m > SYS_VOTE_MAX) m = SYS_VOTE_MAX;
+	if(m == 0) m = 1;
+	if(n > m) n = m;
+	if(n == 0) n = 1;
 
-	//Enter Shutdown State
-	if((sys_ctl_pulse_width >= SYS_OFF_LOWER) &&
-	   (sys_ctl_pulse_width <= SYS_OFF_UPPER))
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		sys_cntl_state = SYS_OFF_STATE;
+		vote_n = n;
+		vote_m = m;
+		clear_votes();
 	}
-	
-	//Enter Activation State
-	else if((sys_ctl_pulse_width >= SYS_ENABLE_LOWER) &&
-	        (sys_ctl_pulse_width <= SYS_ENABLE_UPPER))
+}
+
+/*See system_ctl.h for details*/
+void set_sys_cntl_failsafe(int8_t state, uint16_t timeout)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		sys_cntl_state = SYS_ENABLE_STATE;
+		failsafe_state = state;
+		loss_ticks = timeout * TICKS_PER_MS;
 	}
-	
-	//Enter Emergency Shutdown State
-	else if((sys_ctl_pulse_width >= SYS_MANUAL_OVERRIDE_LOWER) &&
-		    (sys_ctl_pulse_width <= SYS_MANUAL_OVERRIDE_UPPER))
+}
+
+/*See system_ctl.h for details*/
+sys_event get_sys_cntl_event(void)
+{
+	int8_t state = SYS_UNRECOGNIZED_STATE;
+	int8_t prev;
+	bool queued;
+
+	//A lost signal is reported once, ahead of any queued change
+	if(sys_cntl_signal_lost())
 	{
-		sys_cntl_state = SYS_MANUAL_OVERRIDE_STATE;
+		if(loss_reported) return SYS_EVENT_NONE;
+		//Changes from before the loss are stale
+		clear_sys_cntl_events();
+		loss_reported = true;
+		event_state = SYS_UNRECOGNIZED_STATE;
+		return SYS_EVENT_UNKNOWN;
 	}
-	
-	//Retain Current State
-	else
+	loss_reported = false;
+
+	while(1)
 	{
-		sys_cntl_state = SYS_UNRECOGNIZED_STATE;
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			queued = (event_tail != event_head);
+			if(queued)
+			{
+				state = event_queue[event_tail];
+				event_tail = (event_tail + 1) & EVENT_MASK;
+			}
+		}
+
+		if(!queued) return SYS_EVENT_NONE;
+
+		prev = event_state;
+		event_state = state;
+
+		switch(state)
+		{
+			case SYS_OFF_STATE:
+				return SYS_EVENT_OFF;
+
+			case SYS_MANUAL_OVERRIDE_STATE:
+				return SYS_EVENT_OVERRIDE;
+
+			case SYS_ENABLE_STATE:
+				//Only a change from a known state is a command
+				if(prev != SYS_UNRECOGNIZED_STATE) return SYS_EVENT_ENABLE;
+				break;
+
+			default:
+				//Votes restarted after a loss, already reported
+				break;
+		}
 	}
-	
-	//restore interrupts
-	sei();
+}
+
+/*See system_ctl.h for details*/
+void clear_sys_cntl_events(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		event_tail = event_head;
+		event_state = data_ready ? sys_state : SYS_UNRECOGNIZED_STATE;
+	}
+}
+
+/*See system_ctl.h for details*/
+uint8_t get_sys_cntl_prop(void)
+{
+	uint8_t value;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		value = prop_value;
+		if(signal_lost(extend_time(TCNT1) - prop_time, prop_idle_ovf))
+		{
+			value = SYS_PROP_FAILSAFE;
+		}
+	}
+
+	return value;
+}
+
+/*See system_ctl.h for details*/
+bool sys_cntl_prop_lost(void)
+{
+	bool lost;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		lost = signal_lost(extend_time(TCNT1) - prop_time, prop_idle_ovf);
+	}
+
+	return lost;
+}
+
+/*See system_ctl.h for details*/
+void set_sys_cntl_prop_deadband(uint8_t counts)
+{
+	prop_deadband = counts;
+}
+
+/*See system_ctl.h for details*/
+uint16_t get_sys_cntl_channel(uint8_t ch)
+{
+	uint16_t width = 0;
+
+#ifdef SYS_CNTL_PPM
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if((ch < ppm_count) && !ppm_lost()) width = ppm_width[ch];
+	}
+#else
+	(void)ch;
+#endif
+
+	return width;
+}
+
+/*See system_ctl.h for details*/
+uint8_t get_sys_cntl_channels(void)
+{
+	uint8_t count = 0;
+
+#ifdef SYS_CNTL_PPM
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if(!ppm_lost()) count = ppm_count;
+	}
+#endif
+
+	return count;
+}
+
+/*See system_ctl.h for details*/
+bool sys_cntl_frame_synced(void)
+{
+	bool synced = false;
 
-	return sys_cntl_state;
-}	
-/* End of system_ctl.c */
\ No newline at end of file
+#ifdef SYS_CNTL_PPM
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		synced = ppm_synced && !ppm_lost();
+	}
+#endif
+
+	return synced;
+}
+
+/*See system_ctl.h for details*/
+uint8_t get_sys_cntl_frame(void)
+{
+#ifdef SYS_CNTL_PPM
+	return ppm_frame;
+#else
+	return frame_seq;
+#endif
+}
+
+/*See system_ctl.h for details*/
+uint32_t get_sys_cntl_time(void)
+{
+	uint32_t now;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		now = extend_time(TCNT1);
+	}
+
+	return now;
+}
+
+/*See system_ctl.h for details*/
+bool sys_cntl_signal_lost(void)
+{
+	bool lost;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		lost = signal_lost(extend_time(TCNT1) - valid_time, idle_ovf);
+	}
+
+	return lost;
+}
+
+/*See system_ctl.h for details*/
+int8_t get_sys_cntl_state(void)
+{
+	//Wait for the first state to be voted or the signal to time out
+	while(!data_ready && !sys_cntl_signal_lost());
+
+	return peek_sys_cntl_state(NULL);
+}
+
+/*See system_ctl.h for details*/
+int8_t peek_sys_cntl_state(uint16_t *age)
+{
+	int8_t state;
+	uint32_t elapsed;
+	uint16_t idle;
+	bool valid, lost;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		state = sys_state;
+		valid = data_ready;
+		idle = idle_ovf;
+		elapsed = extend_time(TCNT1) - valid_time;
+		lost = signal_lost(elapsed, idle);
+		if(lost) state = failsafe_state;
+	}
+
+	if(age)
+	{
+		if(!valid || (idle >= AGE_MAX_OVF))
+		{
+			*age = SYS_CNTL_AGE_MAX;
+		}
+		else
+		{
+			//Time since the last pulse confirming the state
+			*age = (uint16_t)(elapsed / TICKS_PER_MS);
+		}
+	}
+
+	if(lost) return state;
+
+	return valid ? state : SYS_UNRECOGNIZED_STATE;
+}
+
+/*See system_ctl.h for details*/
+int8_t wait_sys_cntl_state(void)
+{
+	uint8_t seq = frame_seq;
+
+	//Wait for a pulse that completes after the call
+	while((frame_seq == seq) && !sys_cntl_signal_lost());
+
+	return peek_sys_cntl_state(NULL);
+}
+/* End of system_ctl.c */
@@ -7,7 +7,54 @@
  *    are three possible input pulse widths that correspond to three
  *    unique system states: OFF, ENABLE, and MANUAL_OVERRIDE.
  *    This driver uses pin change interrupt 19 to monitor the
- *    system control state continuously. 
+ *    system control state continuously. Each pulse is decoded
+ *    as it completes, so the latest state and its age can be read
+ *    without blocking.
+ *
+ *    Timer/Counter1 runs freely at 1MHz for the pulse timestamps
+ *    and is never reset or stopped, so other modules may read it.
+ *    The edges are timestamped in the pin change interrupt. The
+ *    board cannot time them with a Timer1 input capture instead:
+ *    ICP1 (PD6) is the OC2B output driving the translational motor
+ *    PWM, ICP3 (PB5) is taken by the ultrasonic echoes, and the
+ *    analog comparator, which can also trigger a capture, watches
+ *    for motor overcurrent.
+ *
+ *    Pulses are classified with per-state hysteresis and filtered
+ *    by an N of M vote, so single noisy pulses cannot change the
+ *    state. When no pulse confirms the state for the signal loss
+ *    timeout, the failsafe state is reported until the voting
+ *    filter has settled on a new state. The worst case override
+ *    latency is N frames (20ms each) after the stick is moved.
+ *
+ *    Changes of the filtered state are queued as events so that
+ *    applications can act on operator commands (transitions)
+ *    rather than on levels. An ENABLE event requires a known,
+ *    different state beforehand, so the state seen at power up or
+ *    after the link returns never starts the system by itself.
+ *
+ *    A proportional RC channel on PC4 is read as a 0..255 value
+ *    for live adjustments such as auger speed or feed rate. It
+ *    reports SYS_PROP_FAILSAFE when its signal is lost.
+ *
+ *    Define SYS_CNTL_PPM to read a PPM sum signal of up to
+ *    SYS_PPM_MAX_CH channels on the system control input instead
+ *    of separate pulses. Channel SYS_PPM_STATE_CH then provides the
+ *    system state and SYS_PPM_PROP_CH the proportional value, and
+ *    every channel can be read individually.
+ *
+ *    PPM is decoded in the pin change interrupt only, with software
+ *    timestamps, as the board has no free input capture pin. Each
+ *    rising edge is stamped when PCINT2_vect reads TCNT1, so every
+ *    channel width is off by the difference of two interrupt
+ *    latencies. With no other interrupt running this stays within
+ *    one timer tick (1us). An edge that arrives during another ISR
+ *    or an atomic block waits for it to finish, which adds 1us for
+ *    every 8 cycles it waits (encoder_bench.c measures the encoder
+ *    sampling ISR). Against the 40us band needed to enter a state
+ *    such a pulse can be misclassified near the band edge. The N of
+ *    M vote rejects single bad pulses, and the proportional
+ *    deadband and filter hide the error on the proportional value.
  *
  **************************************************************/
 
@@ -18,6 +65,8 @@
 * 		          Includes                  *
  ********************************************/
 #include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
 
 /********************************************
 * 		           Macros                   *
@@ -29,6 +78,42 @@
 #define SYS_MANUAL_OVERRIDE_STATE  -1  // System Emergency Shutdown 
 #define SYS_UNRECOGNIZED_STATE	   -2  // Unrecognized Input State
 
+/*Age Reported When No Valid Pulse has been Decoded*/
+#define SYS_CNTL_AGE_MAX UINT16_MAX
+
+/*Voting Filter Defaults, N of the Last M Pulses Must Agree*/
+#define SYS_VOTE_MAX 8 //Longest voting window
+#define SYS_VOTE_N   3
+#define SYS_VOTE_M   4
+
+/*Signal Loss Defaults*/
+#define SYS_FAILSAFE_STATE SYS_MANUAL_OVERRIDE_STATE
+#define SYS_LOSS_TIMEOUT   100 //Milliseconds without a valid pulse
+
+/*Proportional Channel Defaults*/
+#define SYS_PROP_DEADBAND 2 //Counts the value must move to change
+#define SYS_PROP_FAILSAFE 0 //Value reported without a signal
+
+/*PPM Channels, Numbered From 0*/
+#define SYS_PPM_MAX_CH   8 //Most channels decoded from a frame
+#define SYS_PPM_STATE_CH 4 //Three position switch for the system state
+#define SYS_PPM_PROP_CH  2 //Proportional channel
+
+/*Depth of the Event Queue, Must be a Power of Two*/
+#define SYS_EVENT_QUEUE 8
+
+/********************************************
+ * 		          Structs                   *
+ ********************************************/
+/*System Control Events*/
+typedef enum {
+	SYS_EVENT_NONE,     //No change since the last call
+	SYS_EVENT_ENABLE,   //Changed to ENABLE from a known state
+	SYS_EVENT_OVERRIDE, //Changed to MANUAL_OVERRIDE
+	SYS_EVENT_OFF,      //Changed to OFF
+	SYS_EVENT_UNKNOWN   //Signal lost, the state is not known
+}sys_event;
+
 /********************************************
  * 		      Function Prototypes           *
  ********************************************/
@@ -37,19 +122,158 @@
  * DESCRIPTION:
  *  - Initializes the system control inteface. Enables pin change
  *    interrrupt 19 and configures PC3 as the system control
- *    input pin.
+ *    input pin. Enables pin change interrupt 20 for the
+ *    proportional channel on PC4. Starts Timer1.
  *
  **************************************************************/
 void init_system_cntl(void);
  
+/***************************************************************
+ * DESCRIPTION:
+ *  - Sets the voting filter. The state changes when "n" of the
+ *    last "m" pulses agree. "m" is limited to SYS_VOTE_MAX and
+ *    "n" to the range 1 to "m". The voting window is cleared.
+ *
+ **************************************************************/
+void set_sys_cntl_filter(uint8_t n, uint8_t m);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Sets the state reported when no pulse has confirmed the
+ *    current state for "timeout" milliseconds. The timeout must
+ *    be longer than N + 1 frames so that a normal state change
+ *    is not reported as a lost signal.
+ *
+ **************************************************************/
+void set_sys_cntl_failsafe(int8_t state, uint16_t timeout);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Returns true if the signal loss timeout has expired and the
+ *    failsafe state is being reported.
+ *
+ **************************************************************/
+bool sys_cntl_signal_lost(void);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Returns the oldest queued system control event without
+ *    blocking, or SYS_EVENT_NONE if the state has not changed.
+ *    Up to SYS_EVENT_QUEUE changes are kept between calls, after
+ *    that the oldest are discarded.
+ *
+ **************************************************************/
+sys_event get_sys_cntl_event(void);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Discards all queued system control events.
+ *
+ **************************************************************/
+void clear_sys_cntl_events(void);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Returns the smoothed proportional channel value, 0 for a
+ *    1000us pulse up to 255 for 2000us. Returns SYS_PROP_FAILSAFE
+ *    if no valid pulse has arrived within the signal loss timeout.
+ *
+ **************************************************************/
+uint8_t get_sys_cntl_prop(void);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Returns true if the proportional channel signal is lost.
+ *
+ **************************************************************/
+bool sys_cntl_prop_lost(void);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Sets how many counts the filtered proportional value must
+ *    move before the reported value changes. Suppresses jitter
+ *    from the transmitter.
+ *
+ **************************************************************/
+void set_sys_cntl_prop_deadband(uint8_t counts);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Returns the width in microseconds of PPM channel "ch" from
+ *    the last complete frame. Returns 0 if the frame has fewer
+ *    channels, the PPM signal is lost or the driver was built
+ *    without SYS_CNTL_PPM.
+ *
+ **************************************************************/
+uint16_t get_sys_cntl_channel(uint8_t ch);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Returns the number of channels in the last complete PPM
+ *    frame, or 0 if the signal is lost.
+ *
+ **************************************************************/
+uint8_t get_sys_cntl_channels(void);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Returns true while PPM frames are received with a constant
+ *    number of channels. Cleared by a glitch within a frame or a
+ *    lost signal.
+ *
+ **************************************************************/
+bool sys_cntl_frame_synced(void);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Returns a count of the frames received, which wraps around.
+ *    A change indicates fresh channel values. Counts the control
+ *    pulses when built without SYS_CNTL_PPM.
+ *
+ **************************************************************/
+uint8_t get_sys_cntl_frame(void);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Returns the free running Timer1 time in microseconds. Wraps
+ *    around after about 71 minutes.
+ *
+ **************************************************************/
+uint32_t get_sys_cntl_time(void);
+
 /***************************************************************
  * DESCRIPTION:
  *  - Returns the current system state as dictated by the remote
  *    control input. The three possible system state inputs are
- *    defined above.
+ *    defined above. Blocks only until the first state has been
+ *    voted or the signal loss timeout expires, after that the
+ *    filtered state is returned without blocking.
  *
  **************************************************************/
 int8_t get_sys_cntl_state(void);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Returns the filtered state without blocking, or the failsafe
+ *    state if the signal has been lost. If "age" is not NULL it
+ *    receives the time in milliseconds since the last pulse that
+ *    confirmed the state, or SYS_CNTL_AGE_MAX if no state has been
+ *    voted yet. SYS_UNRECOGNIZED_STATE is returned before the first
+ *    state is voted. A healthy receiver refreshes the state every
+ *    20ms.
+ *
+ **************************************************************/
+int8_t peek_sys_cntl_state(uint16_t *age);
+
+/***************************************************************
+ * DESCRIPTION:
+ *  - Blocks until a pulse that ends after the call has been
+ *    decoded and returns the filtered state. Takes up to one
+ *    frame (20ms) with a healthy receiver and returns the failsafe
+ *    state if the signal is lost.
+ *
+ **************************************************************/
+int8_t wait_sys_cntl_state(void);
  
 #endif
 /* End of system_ctl.h */
\ No newline at end of file
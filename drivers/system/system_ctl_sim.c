@@ -0,0 +1,278 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host simulation of the system control driver. Runs
+ *    system_ctl.c against the register stand-ins in host_sim, with
+ *    Timer1 counting simulated microseconds. Each RC frame is a
+ *    pulse on PC3 followed by the rest of the 20ms frame, and the
+ *    pin change and overflow vectors are called as the pin and
+ *    timer change. The proportional channel on PC4 rises with the
+ *    control pulse.
+ *
+ *    Built a second time with SYS_CNTL_PPM defined, PC3 instead
+ *    carries a PPM frame of six channels with 300us marks and a
+ *    sync gap that completes the 22.5ms frame.
+ *
+ *      make sim
+ *
+ **************************************************************/
+
+#include "system_ctl.h"
+#include <avr/io.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*RC frame period (us)*/
+#define FRAME_US 20000
+
+/*PPM frame period, mark length (us) and channels sent*/
+#define PPM_FRAME_US 22500
+#define PPM_MARK_US  300
+#define PPM_CHANNELS 6
+
+/*Control input on PC3, proportional input on PC4*/
+#define CTL_PIN  (1 << 3)
+#define PROP_PIN (1 << 4)
+
+/*Interrupt vectors of system_ctl.c*/
+void PCINT2_vect(void);
+void TIMER1_OVF_vect(void);
+
+/*Simulated time (us)*/
+static uint32_t now = 0;
+
+/*Advances Timer1 by "us" ticks of 1us*/
+static void advance(uint32_t us)
+{
+	while(us--)
+	{
+		now++;
+		TCNT1 = (uint16_t)now;
+		if(TCNT1 == 0) TIMER1_OVF_vect();
+		TIFR1 = 0;
+	}
+}
+
+/*Sets the input pins and runs the pin change vector*/
+static void set_pins(uint8_t mask, bool high)
+{
+	if(high) PINC |= mask;
+	else PINC &= ~mask;
+	PCINT2_vect();
+}
+
+#ifndef SYS_CNTL_PPM
+/*Sends "count" frames with a control pulse of "width" us*/
+static void frames(uint16_t width, uint8_t count)
+{
+	while(count--)
+	{
+		set_pins(CTL_PIN, true);
+		advance(width);
+		set_pins(CTL_PIN, false);
+		advance(FRAME_US - width);
+	}
+}
+
+/*Sends "count" frames with a control pulse of "ctl" us and a
+  proportional pulse of "prop" us, both starting together*/
+static void prop_frames(uint16_t ctl, uint16_t prop, uint8_t count)
+{
+	uint16_t first = (ctl < prop) ? ctl : prop;
+	uint16_t last = (ctl < prop) ? prop : ctl;
+
+	while(count--)
+	{
+		set_pins(CTL_PIN | PROP_PIN, true);
+		advance(first);
+		set_pins((ctl < prop) ? CTL_PIN : PROP_PIN, false);
+		advance(last - first);
+		set_pins(CTL_PIN | PROP_PIN, false);
+		advance(FRAME_US - last);
+	}
+}
+
+#endif
+
+static const char *state_name(int8_t state)
+{
+	switch(state)
+	{
+		case SYS_OFF_STATE: return "OFF";
+		case SYS_ENABLE_STATE: return "ENABLE";
+		case SYS_MANUAL_OVERRIDE_STATE: return "OVERRIDE";
+		default: return "UNRECOGNIZED";
+	}
+}
+
+#ifndef SYS_CNTL_PPM
+/*Prints the filtered state after a step of the pulse stream*/
+static void show(const char *step)
+{
+	uint16_t age;
+	int8_t state = peek_sys_cntl_state(&age);
+
+	printf("  %-30s %-12s age %5u ms%s\n", step, state_name(state), age,
+	       sys_cntl_signal_lost() ? ", signal lost" : "");
+}
+
+/*Hysteresis, N of M vote and signal loss failsafe*/
+static void run_filter(void)
+{
+	printf("State filter, %d of %d vote, %dms loss timeout\n",
+	       SYS_VOTE_N, SYS_VOTE_M, SYS_LOSS_TIMEOUT);
+	show("power up");
+	frames(1000, 1); show("OFF x1");
+	frames(1010, 1); show("OFF x2");
+	frames(990, 1);  show("OFF x3");
+	frames(1500, 1); show("single OVERRIDE glitch");
+	frames(1000, 1); show("OFF");
+	frames(1120, 1); show("OFF drifted to 1120us");
+	frames(2000, 2); show("ENABLE x2");
+	frames(2010, 1); show("ENABLE x3");
+	frames(1500, 3); show("OVERRIDE x3");
+	advance(60000);  show("60ms silence");
+	advance(60000);  show("120ms silence");
+	frames(2000, 2); show("ENABLE x2 after loss");
+	frames(2000, 1); show("ENABLE x3 after loss");
+	frames(1250, 6); show("6 frames of 1250us");
+}
+
+/*Prints and consumes the pending events*/
+static void show_events(const char *step)
+{
+	static const char *names[] = {"NONE", "ENABLE", "OVERRIDE", "OFF",
+	                              "UNKNOWN"};
+	sys_event event;
+
+	printf("  %-30s", step);
+	while((event = get_sys_cntl_event()) != SYS_EVENT_NONE)
+	{
+		printf(" %s", names[event]);
+	}
+	printf("\n");
+}
+
+/*Events queued for the application*/
+static void run_events(void)
+{
+	printf("Events\n");
+	clear_sys_cntl_events();
+	frames(1000, 5); show_events("OFF");
+	frames(2000, 5); show_events("ENABLE");
+	frames(1500, 1);
+	frames(2000, 4); show_events("single OVERRIDE glitch");
+	frames(1500, 5); show_events("OVERRIDE");
+	frames(1000, 3);
+	frames(2000, 3); show_events("OFF then ENABLE, read late");
+	advance(200000); show_events("200ms silence");
+	show_events("still silent");
+	frames(2000, 5); show_events("ENABLE after loss");
+	frames(1000, 5);
+	frames(2000, 5); show_events("OFF then ENABLE");
+}
+
+/*Prints the proportional value after a step of the pulse stream*/
+static void show_prop(const char *step)
+{
+	printf("  %-30s %3u%s\n", step, get_sys_cntl_prop(),
+	       sys_cntl_prop_lost() ? ", signal lost" : "");
+}
+
+/*Scaling, smoothing and deadband of the proportional channel*/
+static void run_prop(void)
+{
+	printf("Proportional channel, deadband %d\n", SYS_PROP_DEADBAND);
+	show_prop("no signal");
+	prop_frames(1000, 1500, 1); show_prop("first frame at 1500us");
+	for(uint8_t i = 0; i < 6; i++) prop_frames(1000, (i & 1) ? 1503 : 1497, 1);
+	show_prop("+/-3us jitter x6");
+	prop_frames(1000, 2000, 1); show_prop("step to 2000us x1");
+	prop_frames(1000, 2000, 2); show_prop("step to 2000us x3");
+	prop_frames(1000, 2000, 7); show_prop("step to 2000us x10");
+	prop_frames(1000, 1010, 20); show_prop("1010us x20, in the end band");
+	prop_frames(1000, 1250, 20); show_prop("1250us x20");
+	printf("  %-30s %3u\n", "expected for 1250us",
+	       (unsigned)((1250 - 1030) * 255UL / 940));
+	advance(150000); show_prop("150ms silence");
+}
+
+#else
+/*A PPM mark on PC3*/
+static void ppm_mark(void)
+{
+	set_pins(CTL_PIN, true);
+	advance(PPM_MARK_US);
+	set_pins(CTL_PIN, false);
+}
+
+/*Sends "count" PPM frames of the given channel widths (us)*/
+static void ppm_frames(const uint16_t *width, uint8_t count)
+{
+	while(count--)
+	{
+		uint32_t used = 0;
+
+		for(uint8_t ch = 0; ch < PPM_CHANNELS; ch++)
+		{
+			ppm_mark();
+			advance(width[ch] - PPM_MARK_US);
+			used += width[ch];
+		}
+		ppm_mark();
+		advance(PPM_FRAME_US - used - PPM_MARK_US);
+	}
+}
+
+/*Prints the decoded frame after a step of the pulse stream*/
+static void show_ppm(const char *step)
+{
+	printf("  %-14s %u ch, %s, frame %3u, %-8s prop %3u, ch:", step,
+	       get_sys_cntl_channels(),
+	       sys_cntl_frame_synced() ? "synced  " : "no sync ",
+	       get_sys_cntl_frame(), state_name(peek_sys_cntl_state(NULL)),
+	       get_sys_cntl_prop());
+	for(uint8_t ch = 0; ch < PPM_CHANNELS; ch++)
+	{
+		printf(" %4u", get_sys_cntl_channel(ch));
+	}
+	printf("\n");
+}
+
+/*Sync, channel decoding, glitch rejection and loss of a PPM stream*/
+static void run_ppm(void)
+{
+	static const uint16_t off[PPM_CHANNELS] = {1500, 1500, 1250, 1500, 1000, 1800};
+	static const uint16_t enable[PPM_CHANNELS] = {1500, 1500, 1750, 1500, 2000, 1800};
+	static const uint16_t glitch[PPM_CHANNELS] = {1500, 500, 1750, 1500, 2000, 1800};
+
+	printf("PPM, state on channel %d, proportional on channel %d\n",
+	       SYS_PPM_STATE_CH, SYS_PPM_PROP_CH);
+	ppm_frames(off, 1);    show_ppm("1 frame");
+	ppm_frames(off, 1);    show_ppm("2 frames");
+	ppm_frames(off, 4);    show_ppm("6 frames");
+	ppm_frames(enable, 4); show_ppm("ENABLE x4");
+	ppm_frames(glitch, 1); show_ppm("500us channel");
+	ppm_frames(enable, 3); show_ppm("ENABLE x3");
+	advance(200000);       show_ppm("200ms silence");
+}
+#endif
+
+int main(void)
+{
+	init_system_cntl();
+	TIFR1 = 0;
+
+#ifdef SYS_CNTL_PPM
+	run_ppm();
+#else
+	run_filter();
+	run_events();
+	run_prop();
+#endif
+
+	return 0;
+}
+/* End of system_ctl_sim.c */
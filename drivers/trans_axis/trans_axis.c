@@ -0,0 +1,406 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Implementation of the translational axis position control.
+ *    See trans_axis.h for further details.
+ *
+ **************************************************************/
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include "trans_axis.h"
+#include "pid.h"
+#include "profile.h"
+#include "encoder.h"
+#include "motor.h"
+#include "brake_predict.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Motor directions*/
+#define DIR_UP   -1
+#define DIR_DOWN  1
+
+/*Distance from the start of the move (counts) at which the 16 bit
+  frame of the position loop is moved along with the carriage*/
+#define REBASE_DIST 16384
+
+/********************************************
+ * 	          Global Variables              *
+ ********************************************/
+/*Motion profile and position loop state*/
+static motion_profile trans_prof;
+static pid_ctl trans_pid;
+static int16_t trans_kv = TRANS_AXIS_KV;
+
+/*Axis position in counts and the start of the current move*/
+static int32_t trans_pos = 0;
+static int32_t move_base = 0;
+
+/*Encoder count at the last update and the counts of that window*/
+static uint16_t last_cnt = 0;
+static uint16_t last_moved = 0;
+
+/*Direction the carriage last moved in*/
+static int8_t motion_dir = DIR_DOWN;
+
+/*Gear mode state. The setpoint advances by feed_per_rev counts for
+  every ROTAT_EDGES_PER_REV rotational edges, gear_frac carries the
+  remainder between windows so no feed is lost to rounding*/
+static bool geared = false;
+static int32_t gear_sp = 0;
+static int32_t gear_target = 0;
+static uint16_t gear_ratio = 0;
+static uint32_t gear_frac = 0;
+static int16_t gear_vel = 0;
+static uint16_t last_rot_cnt = 0;
+
+/*Early braking state. The carriage is braked once the coast
+  distance predicted from its velocity covers the rest of the move,
+  and the observed coast is fed back to the predictor*/
+static int32_t move_target = 0;
+static bool coasting = false;
+static int32_t brake_pos = 0;
+static uint16_t brake_vel = 0;
+
+/*Move bookkeeping*/
+static bool moving = false;
+static uint8_t settle_windows = 0;
+static uint8_t last_window = 0;
+
+/********************************************
+ * 	    Static Function Prototypes          *
+ ********************************************/
+static int16_t to_move_frame(int32_t pos);
+static void rebase_move(void);
+static void drive_motor(int16_t cmd);
+static void brake(void);
+static int32_t update_gear(void);
+static bool brake_early(void);
+static bool update_coast(void);
+
+/*Express a position relative to the start of the move in 16 bits*/
+static int16_t to_move_frame(int32_t pos)
+{
+	int32_t rel = pos - move_base;
+	if(rel > INT16_MAX) return INT16_MAX;
+	if(rel < INT16_MIN) return INT16_MIN;
+	return (int16_t)rel;
+}
+
+/*Move the start of the move up to the carriage, so the position
+  loop stays within 16 bits however long the move is*/
+static void rebase_move(void)
+{
+	int32_t rel = trans_pos - move_base;
+
+	if((rel < REBASE_DIST) && (rel > -REBASE_DIST)) return;
+	move_base = trans_pos;
+	shift_pid(&trans_pid, (int16_t)-rel);
+}
+
+/*Brake the translational motor*/
+static void brake(void)
+{
+	brake_translational_motor();
+}
+
+/*Drive the motor with a signed duty command (positive is down)*/
+static void drive_motor(int16_t cmd)
+{
+	int8_t dir = (cmd < 0) ? DIR_UP : DIR_DOWN;
+	uint8_t duty = (cmd < 0) ? (uint8_t)(-cmd) : (uint8_t)cmd;
+
+	/*Commands well below the safety floor brake instead of driving*/
+	if(duty < (get_motor_safety_pwm(TRANS_MOTOR) / 2))
+	{
+		brake();
+		return;
+	}
+
+	/*Direction changes are sequenced by the motor ramp layer*/
+	set_translational_motor_speed(duty);
+	if(dir == DIR_DOWN) translational_motor_down();
+	else translational_motor_up();
+}
+
+/*Advance the geared setpoint by the auger rotation since the last
+  update and return it*/
+static int32_t update_gear(void)
+{
+	uint16_t rot_cnt = get_rotat_encoder_cnt();
+	uint16_t edges = rot_cnt - last_rot_cnt;
+	last_rot_cnt = rot_cnt;
+
+	gear_frac += (uint32_t)edges * gear_ratio;
+	uint32_t step = gear_frac / ROTAT_EDGES_PER_REV;
+	gear_frac -= step * ROTAT_EDGES_PER_REV;
+
+	/*Feed toward the target, stopping on it*/
+	int32_t remaining = gear_target - gear_sp;
+	int32_t dist = (remaining < 0) ? -remaining : remaining;
+	if(step > (uint32_t)dist) step = dist;
+
+	gear_sp += (remaining < 0) ? -(int32_t)step : (int32_t)step;
+	gear_vel = (remaining < 0) ? -(int16_t)step : (int16_t)step;
+
+	return gear_sp;
+}
+
+/*Brake if the predicted coast reaches the end of the move*/
+static bool brake_early(void)
+{
+	int32_t target = geared ? gear_target : move_target;
+	int32_t remaining = (target - trans_pos) * motion_dir;
+	uint16_t vel = get_trans_encoder_velocity();
+
+	if((vel == 0) || (remaining < 0)) return false;
+	if(remaining > predict_brake_distance(vel)) return false;
+
+	brake();
+	coasting = true;
+	brake_pos = trans_pos;
+	brake_vel = vel;
+
+	return true;
+}
+
+/*Wait for the carriage to stop after an early brake, learn the coast
+  distance and finish the move. Returns true while still coasting*/
+static bool update_coast(void)
+{
+	if(get_trans_encoder_velocity() != 0) return true;
+
+	int32_t dist = trans_pos - brake_pos;
+	if(dist < 0) dist = -dist;
+	learn_brake_distance(brake_vel, (dist > UINT16_MAX) ? UINT16_MAX : dist);
+	coasting = false;
+
+	int32_t target = geared ? gear_target : move_target;
+	int32_t err = target - trans_pos;
+
+	if((err <= TRANS_AXIS_TOLERANCE) && (err >= -TRANS_AXIS_TOLERANCE))
+	{
+		stop_trans_axis();
+	}
+	else
+	{
+		/*Short of or past the target, correct with a new move*/
+		geared = false;
+		moving = false;
+		trans_axis_move_to(target);
+	}
+
+	return false;
+}
+
+/********************************************
+ * 		        API Functions               *
+ ********************************************/
+/*See trans_axis.h for details*/
+void init_trans_axis(void)
+{
+	trans_pos = 0;
+	move_base = 0;
+	last_cnt = get_trans_encoder_cnt();
+	last_moved = 0;
+	last_window = get_encoder_window();
+	moving = false;
+	geared = false;
+	coasting = false;
+	trans_kv = TRANS_AXIS_KV;
+
+	init_brake_predictor();
+
+	init_profile(&trans_prof, 0);
+	set_profile_limits(&trans_prof, TRANS_AXIS_MAX_VEL, TRANS_AXIS_MAX_ACC,
+	                   TRANS_AXIS_MAX_JERK);
+	init_pid(&trans_pid, TRANS_AXIS_KP, TRANS_AXIS_KI, TRANS_AXIS_KD,
+	         -MOTOR_MAX_PWM, MOTOR_MAX_PWM);
+	brake();
+}
+
+/*See trans_axis.h for details*/
+void set_trans_axis_limits(uint16_t v_max, uint16_t a_max, uint16_t j_max)
+{
+	set_profile_limits(&trans_prof, v_max, a_max, j_max);
+}
+
+/*See trans_axis.h for details*/
+void set_trans_axis_gains(int16_t kp, int16_t ki, int16_t kd, int16_t kv)
+{
+	set_pid_gains(&trans_pid, kp, ki, kd);
+	trans_kv = kv;
+}
+
+/*See trans_axis.h for details*/
+void set_trans_axis_position(int32_t pos)
+{
+	trans_pos = pos;
+	init_profile(&trans_prof, pos);
+}
+
+/*See trans_axis.h for details*/
+int32_t get_trans_axis_position(void)
+{
+	return trans_pos;
+}
+
+/*See trans_axis.h for details*/
+void trans_axis_move_to(int32_t target)
+{
+	/*Start from rest at the measured position unless already moving,
+	  a geared move hands over from its current setpoint*/
+	if(geared)
+	{
+		init_profile(&trans_prof, gear_sp);
+		geared = false;
+	}
+	else if(!moving)
+	{
+		init_profile(&trans_prof, trans_pos);
+		move_base = trans_pos;
+		reset_pid(&trans_pid, 0);
+	}
+
+	start_profile(&trans_prof, target);
+	move_target = target;
+	coasting = false;
+	settle_windows = TRANS_AXIS_SETTLE_WINDOWS;
+	moving = true;
+}
+
+/*See trans_axis.h for details*/
+void trans_axis_gear_to(int32_t target, uint16_t feed_per_rev)
+{
+	/*Start from the measured position unless already moving*/
+	if(!moving)
+	{
+		move_base = trans_pos;
+		reset_pid(&trans_pid, 0);
+		gear_sp = trans_pos;
+	}
+	else if(!geared)
+	{
+		gear_sp = get_profile_position(&trans_prof);
+	}
+
+	if(!geared)
+	{
+		gear_frac = 0;
+		gear_vel = 0;
+		last_rot_cnt = get_rotat_encoder_cnt();
+	}
+
+	gear_target = target;
+	gear_ratio = feed_per_rev;
+	coasting = false;
+	settle_windows = TRANS_AXIS_SETTLE_WINDOWS;
+	geared = true;
+	moving = true;
+}
+
+/*See trans_axis.h for details*/
+bool trans_axis_geared(void)
+{
+	return geared;
+}
+
+/*See trans_axis.h for details*/
+void stop_trans_axis(void)
+{
+	moving = false;
+	geared = false;
+	coasting = false;
+	brake();
+}
+
+/*See trans_axis.h for details*/
+bool trans_axis_done(void)
+{
+	return !moving;
+}
+
+/*See trans_axis.h for details*/
+bool update_trans_axis(void)
+{
+	uint8_t window = get_encoder_window();
+	uint8_t ticks = window - last_window;
+
+	/*Run once per velocity window*/
+	if(ticks == 0) return false;
+	last_window = window;
+
+	/*Track position, the carriage keeps moving the same way while
+	  braked or reversing until it has nearly stopped*/
+	uint16_t cnt = get_trans_encoder_cnt();
+	uint16_t moved = cnt - last_cnt;
+	last_cnt = cnt;
+
+	int8_t dir = get_motor_direction(TRANS_MOTOR);
+	if((dir != MOTOR_DIR_OFF) && ((last_moved <= TRANS_AXIS_REVERSE_VEL) ||
+	                              (moved <= TRANS_AXIS_REVERSE_VEL)))
+	{
+		motion_dir = (dir == MOTOR_DIR_HIGH) ? DIR_UP : DIR_DOWN;
+	}
+	trans_pos += (int32_t)motion_dir * moved;
+	last_moved = moved;
+
+	if(!moving) return true;
+
+	/*Let the carriage coast onto the target after an early brake*/
+	if(coasting)
+	{
+		update_coast();
+		return true;
+	}
+	if(brake_early()) return true;
+
+	/*Keep the profile on time if windows were missed, the gear
+	  setpoint already accounts for all rotation since the last update*/
+	int32_t sp = 0;
+	int16_t vel = 0;
+	bool sp_done;
+	if(geared)
+	{
+		sp = update_gear();
+		vel = gear_vel;
+		sp_done = (sp == gear_target);
+	}
+	else
+	{
+		while(ticks--) sp = update_profile(&trans_prof);
+		vel = get_profile_velocity(&trans_prof);
+		sp_done = profile_done(&trans_prof);
+	}
+	int32_t err = sp - trans_pos;
+
+	/*Finished once the setpoint is complete and the carriage is on
+	  target, or the settling time has run out*/
+	if(sp_done)
+	{
+		if(((err <= TRANS_AXIS_TOLERANCE) && (err >= -TRANS_AXIS_TOLERANCE)) ||
+		   (settle_windows-- == 0))
+		{
+			stop_trans_axis();
+			return true;
+		}
+	}
+
+	rebase_move();
+	int32_t cmd = update_pid(&trans_pid, to_move_frame(sp),
+	                         to_move_frame(trans_pos));
+	cmd += ((int32_t)trans_kv * vel) >> PID_Q;
+
+	if(cmd > MOTOR_MAX_PWM) cmd = MOTOR_MAX_PWM;
+	if(cmd < -MOTOR_MAX_PWM) cmd = -MOTOR_MAX_PWM;
+	drive_motor((int16_t)cmd);
+
+	return true;
+}
+/* End of trans_axis.c */
@@ -0,0 +1,185 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Position control of the translational (feed) axis. Moves are
+ *    planned by a jerk-limited trapezoidal motion profile and
+ *    followed by a PID position loop with velocity feedforward
+ *    that drives the translational motor. The loop runs once per
+ *    encoder velocity window (~100Hz).
+ *
+ *    In gear mode the position setpoint instead follows the auger
+ *    rotation measured by the rotational encoder, so the carriage
+ *    feeds a fixed distance per auger revolution regardless of the
+ *    auger speed, like rigid tapping on a CNC spindle.
+ *
+ *    Near the end of a move the carriage is braked early, once the
+ *    coast distance predicted from its velocity (brake_predict.h)
+ *    covers the rest of the move, and each observed coast is used
+ *    to refine the prediction. The application should call
+ *    save_brake_predictor() while idle to keep what was learned.
+ *
+ *    The translational encoder only counts edges, so the axis
+ *    position is signed by the direction the motor was last driven
+ *    in. Positions are in encoder counts, positive is down (deeper).
+ *
+ **************************************************************/
+
+#ifndef TRANS_AXIS_H_
+#define TRANS_AXIS_H_
+
+/********************************************
+ * 		          Includes                  *
+ ********************************************/
+#include <stdint.h>
+#include <stdbool.h>
+#include "pid.h"
+#include "profile.h"
+#include "encoder.h"
+
+/********************************************
+ * 		           Macros                   *
+ ********************************************/
+/*Default motion limits (counts per window, see profile.h). The
+  velocity limit leaves headroom below the fastest speed the encoder
+  sampler can measure, so overshoot does not alias the count*/
+#define TRANS_AXIS_MAX_VEL  PROFILE_LIMIT((ENCODER_MAX_VELOCITY * 4) / 5)
+#define TRANS_AXIS_MAX_ACC  PROFILE_LIMIT(4)
+#define TRANS_AXIS_MAX_JERK PROFILE_LIMIT(0.5)
+
+/*Default position loop gains (Q8.8)*/
+#define TRANS_AXIS_KP PID_GAIN(2.0)
+#define TRANS_AXIS_KI PID_GAIN(0.05)
+#define TRANS_AXIS_KD PID_GAIN(0)
+/*Velocity feedforward in duty per count/window (Q8.8)*/
+#define TRANS_AXIS_KV PID_GAIN(1.6)
+
+/*Encoder counts per mm of carriage travel, an estimate that should
+  be measured on the drill*/
+#define TRANS_AXIS_COUNTS_PER_MM 100L
+
+/*Converts a distance in mm to encoder counts*/
+#define TRANS_AXIS_MM(mm) ((int32_t)(mm) * TRANS_AXIS_COUNTS_PER_MM)
+
+/*Position error accepted at the end of a move (counts)*/
+#define TRANS_AXIS_TOLERANCE 20
+
+/*Windows allowed to settle after the profile completes*/
+#define TRANS_AXIS_SETTLE_WINDOWS 50
+
+/*The encoder only counts edges, so the counting direction follows
+  the motor only once the carriage has slowed to this speed
+  (counts per window)*/
+#define TRANS_AXIS_REVERSE_VEL 8
+
+/********************************************
+ * 		      Function Prototypes           *
+ ********************************************/
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Initializes the translational axis at position zero with the
+ *    default limits and gains. The encoder and motor drivers must
+ *    be initialized and the encoders started first.
+ *
+ **************************************************************/
+void init_trans_axis(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Sets the velocity, acceleration and jerk limits used to plan
+ *    moves. Values are Q8.8, see PROFILE_LIMIT() in profile.h.
+ *    May be changed while a move is in progress.
+ *
+ **************************************************************/
+void set_trans_axis_limits(uint16_t v_max, uint16_t a_max, uint16_t j_max);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Sets the position loop gains and velocity feedforward gain.
+ *    All values are Q8.8, see PID_GAIN() in pid.h.
+ *
+ **************************************************************/
+void set_trans_axis_gains(int16_t kp, int16_t ki, int16_t kd, int16_t kv);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Redefines the current axis position without moving. Used to
+ *    set the zero reference of the axis.
+ *
+ **************************************************************/
+void set_trans_axis_position(int32_t pos);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the axis position in encoder counts.
+ *
+ **************************************************************/
+int32_t get_trans_axis_position(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Starts a profiled move to "target" (counts). Returns
+ *    immediately, update_trans_axis() performs the move.
+ *
+ **************************************************************/
+void trans_axis_move_to(int32_t target);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Starts a geared move to "target" (counts). The position
+ *    setpoint advances "feed_per_rev" counts toward the target per
+ *    auger revolution (ROTAT_EDGES_PER_REV rotational edges), in
+ *    either rotation direction, and the auger speed is left to the
+ *    caller. Returns immediately, update_trans_axis() performs the
+ *    move. The move ends like a profiled move once the setpoint
+ *    reaches the target.
+ *
+ **************************************************************/
+void trans_axis_gear_to(int32_t target, uint16_t feed_per_rev);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns true while a geared move is in progress.
+ *
+ **************************************************************/
+bool trans_axis_geared(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Aborts any move in progress and brakes the translational
+ *    motor.
+ *
+ **************************************************************/
+void stop_trans_axis(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns true when no move is in progress.
+ *
+ **************************************************************/
+bool trans_axis_done(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Tracks the axis position and runs the profile and position
+ *    loop if a new encoder velocity window has completed since the
+ *    last update. Should be called from the application loop at
+ *    least once per window (10ms). Returns true if the loop ran.
+ *
+ **************************************************************/
+bool update_trans_axis(void);
+
+#endif
+/* End of trans_axis.h */
@@ -0,0 +1,80 @@
+#define F_CPU 8000000UL
+
+#include "trans_axis.h"
+#include "encoder.h"
+#include "motor.h"
+#include "lcd_driver.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+
+/*Travel of each geared move in encoder counts*/
+#define TEST_DIST 16000L
+
+/*Feed per auger revolution (counts)*/
+#define TEST_FEED 2000
+
+/*Auger duty cycles, switched half way down*/
+#define FAST_DUTY 200
+#define SLOW_DUTY 100
+
+/*From itoa.c*/
+extern char *num_to_str(int i);
+
+int main()
+{
+	sei();
+
+	initialize_LCD_driver();
+	init_encoders();
+	init_motor_drivers();
+	brake_translational_motor();
+	brake_rotational_motor();
+	start_encoders();
+	init_trans_axis();
+
+	/*Gear down with the auger slowing part way, display the feed per
+	  revolution achieved, then return to the top*/
+	while(1)
+	{
+		int32_t start = get_trans_axis_position();
+		uint16_t last_rotat = get_rotat_encoder_cnt();
+		int32_t rotat_edges = 0;
+
+		set_rotational_motor_speed(FAST_DUTY);
+		rotational_motor_left();
+		trans_axis_gear_to(TEST_DIST, TEST_FEED);
+
+		while(!trans_axis_done())
+		{
+			if(update_trans_axis())
+			{
+				uint16_t rotat = get_rotat_encoder_cnt();
+				rotat_edges += (uint16_t)(rotat - last_rotat);
+				last_rotat = rotat;
+			}
+
+			if(get_trans_axis_position() > TEST_DIST / 2)
+			{
+				set_rotational_motor_speed(SLOW_DUTY);
+			}
+		}
+		brake_rotational_motor();
+
+		lcd_erase();
+		lcd_puts("FEED/REV ");
+		if(rotat_edges > 0)
+		{
+			int32_t travel = get_trans_axis_position() - start;
+			lcd_puts(num_to_str((int)((travel * (int32_t)ROTAT_EDGES_PER_REV) /
+			                          rotat_edges)));
+		}
+		_delay_ms(1000);
+
+		trans_axis_move_to(0);
+		while(!trans_axis_done()) update_trans_axis();
+		_delay_ms(1000);
+	}
+
+	return 0;
+}
@@ -0,0 +1,245 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host simulation of the translational axis. Runs trans_axis.c
+ *    with the real profile, PID, brake predictor and encoder driver
+ *    against a simple carriage model in place of the motor driver.
+ *    The carriage speed follows the duty with a first order lag
+ *    each velocity window and coasts down when braked. Its position
+ *    and the auger rotation drive the quadrature inputs, which the
+ *    encoder ISR samples at its real rate, so a carriage faster than
+ *    the sampler can follow is miscounted as on the drill. Each move
+ *    reports its peak speed next to the peak the encoder measured.
+ *
+ *    The braking distance predictor is then reset and a series of
+ *    long moves shows the landing error as the fit learns the
+ *    coast of the carriage.
+ *
+ *    A move from well above the soil surface to the full sample
+ *    depth, with the carriage slowed by hard soil, checks that the
+ *    position loop still corrects moves longer than 16 bits of
+ *    counts.
+ *
+ *    A geared move is also run with the auger slowing half way, to
+ *    check that the feed per revolution does not follow the auger
+ *    speed.
+ *
+ *    The model constants are estimates and should be replaced
+ *    with values measured on the drill.
+ *
+ *      make sim
+ *
+ **************************************************************/
+
+#include "trans_axis.h"
+#include "brake_predict.h"
+#include "encoder.h"
+#include "motor.h"
+#include "speed_ctl.h"
+#include <avr/io.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+/*Carriage model (counts per window)*/
+#define FULL_SPEED  160.0 //Speed at full duty
+#define SPEED_LAG   4.0   //Windows to reach the commanded speed
+#define COAST_DECAY 0.7   //Speed kept per window while braked
+#define SAFETY_PWM  50
+#define HARD_SOIL   0.7   //Share of the speed reached in hard soil
+
+/*Longest move simulated (windows)*/
+#define MOVE_TIMEOUT 3000
+
+/*Learned landing, number and length of the moves*/
+#define LANDING_MOVES 8
+#define LANDING_DIST  20000
+
+/*Windows the carriage is left to come to rest after a move*/
+#define REST_WINDOWS 30
+
+/*Geared move, feed per revolution and auger speeds (edges/window)*/
+#define GEAR_FEED  2000
+#define FAST_AUGER ROTAT_DRILL_SPEED
+#define SLOW_AUGER (ROTAT_DRILL_SPEED / 2)
+#define GEAR_BLOCK 150 //Windows per feed/rev measurement
+
+/*Encoder sampling vector of encoder.c*/
+void TIMER0_COMPA_vect(void);
+
+/*Quadrature states in order of motion*/
+static const uint8_t gray[4] = {0, 1, 3, 2};
+
+/*Carriage state*/
+static double speed = 0;      //Counts per window, positive is down
+static double position = 0;   //True position in counts
+static int8_t drive_dir = MOTOR_DIR_OFF;
+static uint8_t duty = 0;
+static double drag = 1.0;     //Share of the commanded speed reached
+
+/*Auger speed in rotational edges per window and edges turned*/
+static uint16_t auger_speed = 0;
+static double auger_pos = 0;
+
+/*Motor driver stand-ins*/
+uint8_t get_motor_safety_pwm(motor_id id) { (void)id; return SAFETY_PWM; }
+int8_t get_motor_direction(motor_id id) { (void)id; return drive_dir; }
+
+void set_translational_motor_speed(uint8_t speed)
+{
+	duty = (speed < SAFETY_PWM) ? SAFETY_PWM : speed;
+}
+
+void translational_motor_down(void) { drive_dir = MOTOR_DIR_LOW; }
+void translational_motor_up(void) { drive_dir = MOTOR_DIR_HIGH; }
+void brake_translational_motor(void) { drive_dir = MOTOR_DIR_OFF; }
+
+/*Sets the quadrature inputs of one encoder from its position*/
+static uint8_t quadrature(uint8_t pins, uint8_t a_pos, double pos)
+{
+	uint8_t state = gray[(long)floor(pos) & 0x03];
+	return (pins & ~(0x03 << a_pos)) | (state << a_pos);
+}
+
+/*Advances the carriage by one velocity window, sampling the encoders
+  at the rate of the encoder ISR*/
+static void step(void)
+{
+	uint8_t window = get_encoder_window();
+
+	if(drive_dir == MOTOR_DIR_OFF)
+	{
+		speed *= COAST_DECAY;
+		if(fabs(speed) < 0.5) speed = 0;
+	}
+	else
+	{
+		double sign = (drive_dir == MOTOR_DIR_LOW) ? 1.0 : -1.0;
+		speed += (sign * drag * FULL_SPEED * duty / MOTOR_MAX_PWM - speed) /
+		         SPEED_LAG;
+	}
+
+	while(get_encoder_window() == window)
+	{
+		position += speed / ENCODER_VELOCITY_WINDOW;
+		auger_pos += (double)auger_speed / ENCODER_VELOCITY_WINDOW;
+
+		uint8_t pins = quadrature(PIND, TRANS_ENCODER_A_POS, position);
+		PIND = quadrature(pins, ROTAT_ENCODER_A_POS, auger_pos);
+		TIMER0_COMPA_vect();
+	}
+}
+
+/*Runs a profiled move to completion and reports it*/
+static void run_move(int32_t target)
+{
+	double peak = 0;
+	uint16_t peak_read = 0;
+	int t = 0;
+
+	trans_axis_move_to(target);
+	while(!trans_axis_done() && (t < MOVE_TIMEOUT))
+	{
+		step();
+		update_trans_axis();
+		if(fabs(speed) > peak) peak = fabs(speed);
+		if(get_trans_encoder_velocity() > peak_read)
+		{
+			peak_read = get_trans_encoder_velocity();
+		}
+		t++;
+	}
+	for(int i = 0; i < REST_WINDOWS; i++)
+	{
+		step();
+		update_trans_axis();
+	}
+
+	printf("  to %6ld: %4d windows, peak %5.1f counts/window (read %3u), "
+	       "final %7.0f (error %+4.0f), axis reads %ld\n",
+	       (long)target, t, peak, peak_read, position, position - target,
+	       (long)get_trans_axis_position());
+}
+
+/*Runs a geared move to completion, slowing the auger half way, and
+  reports the feed per revolution over each block of windows*/
+static void run_geared(int32_t target, uint16_t feed)
+{
+	double half = position + (target - position) / 2;
+	double block_pos = position;
+	uint32_t block_edges = 0;
+	int t = 0;
+
+	auger_speed = FAST_AUGER;
+	trans_axis_gear_to(target, feed);
+	while(!trans_axis_done() && (t < MOVE_TIMEOUT))
+	{
+		step();
+		update_trans_axis();
+		block_edges += auger_speed;
+		t++;
+
+		if((t % GEAR_BLOCK) == 0)
+		{
+			printf("  window %3d: auger %3u edges/window, feed/rev %4.0f\n",
+			       t, auger_speed,
+			       (position - block_pos) * ROTAT_EDGES_PER_REV / block_edges);
+			block_pos = position;
+			block_edges = 0;
+		}
+
+		if(position >= half) auger_speed = SLOW_AUGER;
+	}
+	auger_speed = 0;
+	for(int i = 0; i < REST_WINDOWS; i++)
+	{
+		step();
+		update_trans_axis();
+	}
+
+	printf("  to %6ld: %4d windows, final %7.0f (error %+4.0f), "
+	       "axis reads %ld\n",
+	       (long)target, t, position, position - target,
+	       (long)get_trans_axis_position());
+}
+
+int main(void)
+{
+	init_encoders();
+	start_encoders();
+	init_trans_axis();
+
+	printf("Profiled moves, limit %d counts/window\n",
+	       TRANS_AXIS_MAX_VEL >> PROFILE_Q);
+	run_move(32000);
+	run_move(0);
+	run_move(500);
+	run_move(0);
+
+	printf("Long move, from 200mm above the surface to the sample depth\n");
+	run_move(-TRANS_AXIS_MM(200));
+	drag = HARD_SOIL;
+	run_move(TRANS_AXIS_MM(320));
+	drag = 1.0;
+	run_move(0);
+
+	printf("Landing from a reset brake predictor\n");
+	reset_brake_predictor();
+	for(int i = 0; i < LANDING_MOVES; i++)
+	{
+		run_move((i % 2) ? 0 : LANDING_DIST);
+		printf("           %u stops learned, predicts %u counts "
+		       "from %d counts/window\n", get_brake_samples(),
+		       predict_brake_distance(TRANS_AXIS_MAX_VEL >> PROFILE_Q),
+		       TRANS_AXIS_MAX_VEL >> PROFILE_Q);
+	}
+
+	printf("Geared move, %d counts/rev\n", GEAR_FEED);
+	run_geared(20000, GEAR_FEED);
+	run_move(0);
+
+	return 0;
+}
+/* End of trans_axis_sim.c */
@@ -0,0 +1,44 @@
+#define F_CPU 8000000UL
+
+#include "trans_axis.h"
+#include "encoder.h"
+#include "motor.h"
+#include "lcd_driver.h"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+
+/*Travel of each test move in encoder counts*/
+#define TEST_DIST 16000L
+
+/*From itoa.c*/
+extern char *num_to_str(int i);
+
+int main()
+{
+	int32_t target = TEST_DIST;
+
+	sei();
+
+	initialize_LCD_driver();
+	init_encoders();
+	init_motor_drivers();
+	brake_translational_motor();
+	start_encoders();
+	init_trans_axis();
+
+	/*Move back and forth, displaying the final position of each move*/
+	while(1)
+	{
+		trans_axis_move_to(target);
+		while(!trans_axis_done()) update_trans_axis();
+
+		lcd_erase();
+		lcd_puts(num_to_str((int)get_trans_axis_position()));
+		_delay_ms(1000);
+
+		target = (target == 0) ? TEST_DIST : 0;
+	}
+
+	return 0;
+}
@@ -5,8 +5,41 @@
  *  - Driver that enables reading of an ultrasonic ping sensor
  *    such as those made by Polulu or Parallax. The driver utilizes
  *    the pin change interrupt functionality of an AVR micrcontroller
- *    to determine distance of an obstacle. Timer overflow interrupts
- *    are used to provide a timeout feature to the software. 
+ *    to determine distance of an obstacle.
+ *
+ *    Ranging runs in the background. Timer/Counter3 runs freely
+ *    at 1MHz and its compare match A interrupt starts a slot of
+ *    the schedule every slot period. Each slot pings a group of
+ *    sensors that cannot hear each other together. Compare match B
+ *    ends the trigger pulses, the pin change interrupt timestamps
+ *    the echo edges of each sensor of the group and the overflow
+ *    interrupt extends the timer to 32 bits. A ping whose echo has
+ *    not ended by the next slot is published as a timeout.
+ *
+ *    The schedule is built from the cross-talk table, which says
+ *    which sensors each sensor can hear. Sensors are given slots
+ *    so that no two sensors in a slot hear each other, using as
+ *    few slots as possible so each sensor is pinged as often as
+ *    possible. The slot period is US_PING_PERIOD, stretched when
+ *    the schedule is so short that a sensor would be pinged again
+ *    within US_REVISIT_MIN. Every sensor keeps its own echo state.
+ *
+ *    Building with US_INPUT_CAPTURE defined timestamps the echo
+ *    edges with the Timer3 input capture unit instead of the pin
+ *    change interrupt, which removes the interrupt latency from
+ *    the measurement.
+ *
+ *    Distances are integer millimetres. The echo time is scaled
+ *    by the speed of sound for the current air temperature,
+ *    c = 331.3 + 0.606 * T m/s, held as mm/us in Q16 so that only
+ *    a 32-bit integer multiply is needed per reading.
+ *
+ *    Each reading is also passed through a median and outlier
+ *    filter (see range_filter.h) to give a steady ground distance.
+ *    The filter runs as the bottom half of the interrupt that
+ *    published the reading: the echo interrupt is already masked,
+ *    so interrupts are enabled again before filtering and the
+ *    trigger and echo timing of the other sensors is not delayed.
  *
  **************************************************************/
 
@@ -15,14 +48,15 @@
 
 /********************************************
  * 		          Includes                  *
- ********************************************/ 
+ ********************************************/
 #include "ultrasonic.h"
+#include "range_filter.h"
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <util/atomic.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdfix.h>
-#include <util/delay.h>
 
 /********************************************
  * 		           Macros                   *
@@ -40,97 +74,305 @@
 #define WGM33 4
 #define WGM32 3
 #define WGM31 1
-#define WGM30 0 
+#define WGM30 0
 
 /*Timer3 Clock Select Bits*/
 #define CS32 2
 #define CS31 1
 #define CS30 0
 
-/*Timer3 Interrupt Mask*/
-#define TOIE3 0
+/*Timer3 Input Capture Noise Canceler and Edge Select*/
+#define ICNC3 7
+#define ICES3 6
 
-/*Delay Macros*/
-#define LOW  1
-#define HIGH 10
+/*Timer3 Interrupt Mask and Flag Bits*/
+#define ICIE3  5
+#define ICF3   5
+#define OCIE3B 2
+#define OCIE3A 1
+#define TOIE3  0
+#define OCF3B  2
+#define OCF3A  1
+#define TOV3   0
+
+/*Mask of every sensor*/
+#define ALL_SENSORS ((1 << NUM_SENSORS) - 1)
+
+#if NUM_SENSORS > US_MAX_SENSORS
+#error "NUM_SENSORS exceeds US_MAX_SENSORS"
+#endif
+#if (NUM_SENSORS > 2) && !defined(TRIGGER_C_PORT)
+#error "Define the pins of sensor C in ultrasonic.h"
+#endif
+#if (NUM_SENSORS > 3) && !defined(TRIGGER_D_PORT)
+#error "Define the pins of sensor D in ultrasonic.h"
+#endif
+
+/*Trigger pulse length in timer ticks (us)*/
+#define TRIGGER_TICKS 12
+
+/*Longest echo from an obstacle (us), a sensor that hears nothing
+  holds its echo for about 38ms*/
+#define ECHO_MAX_TICKS 30000UL
 
 /*Mask to clear registers*/
 #define CLEAR 0x00
 
-/*The speed of sound in centimeters/microsecond*/
-#define SPEED_SOUND 0.0343F
+/*Speed of sound in mm/s at 0C and its change per degree C*/
+#define SOUND_MM_S_0C    331300L
+#define SOUND_MM_S_PER_C 606L
+
+/*Converts mm/s to mm/us in Q16, 2^16/10^6 = 1024/15625*/
+#define SOUND_Q16(mm_s) ((uint16_t)(((mm_s) * 1024L) / 15625L))
+
+/*Temperature limits of the speed of sound model*/
+#define TEMP_MIN -40
+#define TEMP_MAX 85
+
+/********************************************
+ * 		          Structs                   *
+ ********************************************/
+/*Latest Reading of a Sensor*/
+typedef struct {
+	uint16_t width;     //Echo pulse width in us, 0 for a timeout
+	uint32_t time;      //Time the ping was triggered in us
+	uint8_t count;      //Readings published, wraps around
+	uint16_t ground;    //Filtered distance in mm, 0 if none
+	uint8_t confidence; //Share of recent readings accepted (%)
+}range_reading;
+
+/*Echo State of a Sensor*/
+typedef struct {
+	bool started;  //Rising edge seen
+	bool done;     //Echo ended or timed out
+	uint32_t rise; //Time of the rising edge in us
+}echo_state;
+
+/*Pins of a Sensor*/
+typedef struct {
+	volatile uint8_t *port; //Trigger output port
+	volatile uint8_t *ddr;  //Trigger data direction register
+	uint8_t trigger;        //Trigger pin mask
+	uint8_t echo;           //Echo pin mask on US_ECHO_PORT
+}sensor_pins;
 
 /********************************************
  * 	          Global Variables              *
  ********************************************/
-/*Represents sensor in use*/
-static sensor curr_sensor_id;
+/*Pins of each sensor*/
+static const sensor_pins pins[NUM_SENSORS] = {
+	{&PORT(TRIGGER_A_PORT), &DDR(TRIGGER_A_PORT),
+	 (1 << TRIGGER_A_POS), (1 << ECHO_A_POS)},
+#if NUM_SENSORS > 1
+	{&PORT(TRIGGER_B_PORT), &DDR(TRIGGER_B_PORT),
+	 (1 << TRIGGER_B_POS), (1 << ECHO_B_POS)},
+#endif
+#if NUM_SENSORS > 2
+	{&PORT(TRIGGER_C_PORT), &DDR(TRIGGER_C_PORT),
+	 (1 << TRIGGER_C_POS), (1 << ECHO_C_POS)},
+#endif
+#if NUM_SENSORS > 3
+	{&PORT(TRIGGER_D_PORT), &DDR(TRIGGER_D_PORT),
+	 (1 << TRIGGER_D_POS), (1 << ECHO_D_POS)},
+#endif
+};
+
+/*Sensors each sensor can hear*/
+static uint8_t hears[NUM_SENSORS] = {
+	US_HEARS_A,
+#if NUM_SENSORS > 1
+	US_HEARS_B,
+#endif
+#if NUM_SENSORS > 2
+	US_HEARS_C,
+#endif
+#if NUM_SENSORS > 3
+	US_HEARS_D,
+#endif
+};
+
+/*Sensors pinged in each slot of the schedule*/
+static uint8_t slots[NUM_SENSORS];
+static uint8_t num_slots = NUM_SENSORS;
+
+/*Time between slots (us)*/
+static uint16_t slot_period = US_PING_PERIOD;
+
+/*Slot in progress and its sensors*/
+static volatile uint8_t curr_slot = 0;
+static volatile uint8_t active = 0;
+
+/*Echo state of each sensor*/
+static volatile echo_state echoes[NUM_SENSORS];
+
+/*Time the slot in progress was pinged*/
+static uint32_t ping_time = 0;
 
-/*Echo returned flag*/
-volatile bool echo;
+#ifndef US_INPUT_CAPTURE
+/*Echo pin levels at the last pin change*/
+static uint8_t last_echo = 0;
+#endif
 
-/*Timeout Flag*/
-volatile bool timeout = false;
+/*Latest reading of each sensor*/
+static volatile range_reading readings[NUM_SENSORS];
 
-/*Width of pulse returned by sensor*/
-volatile uint16_t pulse_width = 0;
+/*Median and outlier filter of each sensor*/
+static range_filter filters[NUM_SENSORS];
+
+/*Sensors with a reading waiting for its filter update*/
+static volatile uint8_t filter_pending = 0;
+
+/*Upper 16 bits of the Timer3 time*/
+static volatile uint16_t time_hi = 0;
+
+/*Background ranging is running*/
+static volatile bool ranging = false;
+
+/*Speed of sound in mm/us (Q16)*/
+static volatile uint16_t sound_q16 =
+	SOUND_Q16(SOUND_MM_S_0C + SOUND_MM_S_PER_C * US_DEFAULT_TEMP);
 
 /********************************************
  * 	    Static Function Prototypes          *
  ********************************************/
-static void set_trigger_a(void);
-static void clear_trigger_a(void);
-static void set_trigger_b(void);
-static void clear_trigger_b(void);
-static void pulse_trigger_a(void);
-static void pulse_trigger_b(void);
+static void set_triggers(uint8_t mask);
+static void clear_triggers(uint8_t mask);
+static void select_echoes(uint8_t mask);
+static void echo_edge(sensor id, bool rising, uint32_t stamp);
+static bool fill_slots(uint8_t id, uint8_t count);
+static void build_schedule(void);
 static void start_counter(void);
-static void stop_counter(void);
-static bool detect_rising_edge(void);
-static accum us_to_cm(uint16_t time);
+static uint32_t extend_time(uint16_t ticks);
+static void publish(sensor id, uint16_t width);
+static uint16_t us_to_mm(uint16_t time);
+static void filter_reading(void);
 
-/*Sets trigger a output high*/
-static void set_trigger_a(void)
+/*Sets the trigger outputs of a group of sensors high*/
+static void set_triggers(uint8_t mask)
 {
-	PORT(TRIGGER_A_PORT) |= (1 << TRIGGER_A_POS);
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
+	{
+		if(mask & (1 << id)) *pins[id].port |= pins[id].trigger;
+	}
 }
 
-/*Clears trigger a output to low*/
-static void clear_trigger_a(void)
+/*Clears the trigger outputs of a group of sensors low*/
+static void clear_triggers(uint8_t mask)
 {
-	PORT(TRIGGER_A_PORT) &= ~(1 << TRIGGER_A_POS);
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
+	{
+		if(mask & (1 << id)) *pins[id].port &= ~pins[id].trigger;
+	}
 }
 
-/*Sets trigger b output high*/
-static void set_trigger_b(void)
+/*Ensures only the pinged sensors can generate interrupts*/
+static void select_echoes(uint8_t mask)
 {
-	PORT(TRIGGER_B_PORT) |= (1 << TRIGGER_B_POS);
+#ifdef US_INPUT_CAPTURE
+	(void)mask;
+	/*All echoes share ICP3, capture the rising edge first*/
+	TCCR3B |= (1 << ICES3);
+	TIFR3 = (1 << ICF3);
+	TIMSK3 |= (1 << ICIE3);
+#else
+	uint8_t pcmsk = CLEAR;
+
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
+	{
+		if(mask & (1 << id)) pcmsk |= pins[id].echo;
+	}
+
+	/*Echo pins are PCINT7:0, bit n is pin n*/
+	last_echo = PIN(US_ECHO_PORT);
+	PCMSK0 = pcmsk;
+#endif
 }
 
-/*Clears trigger b output low*/
-static void clear_trigger_b(void)
+/*Records an edge of the returned pulse of a sensor*/
+static void echo_edge(sensor id, bool rising, uint32_t stamp)
 {
-	PORT(TRIGGER_B_PORT) &= ~(1 << TRIGGER_B_POS);
+	volatile echo_state *echo = &echoes[id];
+
+	if(echo->done) return;
+
+	/*Rising edge*/
+	if(rising)
+	{
+		echo->rise = stamp;
+		echo->started = true;
+	}
+	/*Falling edge*/
+	else if(echo->started)
+	{
+		uint32_t width = stamp - echo->rise;
+
+		//Count only one direction
+		publish(id, (width < ECHO_MAX_TICKS) ? (uint16_t)(width >> 1) : 0);
+		echo->done = true;
+#ifdef US_INPUT_CAPTURE
+		TIMSK3 &= ~(1 << ICIE3);
+#else
+		PCMSK0 &= ~pins[id].echo;
+#endif
+	}
 }
 
-/*Triggers a pulse to be transmitted by the sensor*/
-static void pulse_trigger_a(void)
+/*Places sensors id and above in the first "count" slots so that no
+  slot holds two sensors that hear each other, returns false if
+  they do not fit*/
+static bool fill_slots(uint8_t id, uint8_t count)
 {
-	clear_trigger_a();
-	_delay_us(LOW); //hold low 1 us
-	set_trigger_a();
-	_delay_us(HIGH); //hold high 10 us
-	clear_trigger_a();
+	if(id == NUM_SENSORS) return true;
+
+	for(uint8_t s = 0; s < count; s++)
+	{
+		if(slots[s] & hears[id]) continue;
+
+		slots[s] |= (1 << id);
+		if(fill_slots(id + 1, count)) return true;
+		slots[s] &= ~(1 << id);
+	}
+
+	return false;
 }
 
-/*Triggers a pulse to be transmitted by the sensor*/
-static void pulse_trigger_b(void)
+/*Finds the shortest schedule, which gives each sensor the highest
+  update rate, by trying one slot, then two, and so on*/
+static void build_schedule(void)
 {
-	clear_trigger_b();
-	_delay_us(LOW); //hold low 1 us
-	set_trigger_b();
-	_delay_us(HIGH); //hold high 10 us
-	clear_trigger_b();
+	/*Cross-talk goes both ways*/
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
+	{
+		hears[id] |= (1 << id);
+#ifdef US_INPUT_CAPTURE
+		/*One capture unit, one sensor per slot*/
+		hears[id] = 0xFF;
+#endif
+		for(uint8_t other = 0; other < NUM_SENSORS; other++)
+		{
+			if(hears[other] & (1 << id)) hears[id] |= (1 << other);
+		}
+	}
+
+	for(num_slots = 1; num_slots < NUM_SENSORS; num_slots++)
+	{
+		for(uint8_t s = 0; s < NUM_SENSORS; s++) slots[s] = 0;
+		if(fill_slots(0, num_slots)) break;
+	}
+
+	/*Every sensor on its own*/
+	if(num_slots == NUM_SENSORS)
+	{
+		for(uint8_t s = 0; s < NUM_SENSORS; s++) slots[s] = (1 << s);
+	}
+
+	/*Stretch short schedules so a sensor is not pinged again while
+	  the echo of a ping that heard nothing is still high*/
+	slot_period = US_PING_PERIOD;
+	if(((uint32_t)num_slots * US_PING_PERIOD) < US_REVISIT_MIN)
+	{
+		slot_period = (US_REVISIT_MIN + num_slots - 1) / num_slots;
+	}
 }
 
 /*Enables Timer/Counter3*/
@@ -140,57 +382,152 @@ static void start_counter(void)
 	TCCR3B |= (1 << CS31);
 }
 
-/*Shuts off Timer/Counter3*/
-static void stop_counter(void)
+/*Extends a Timer3 value to 32 bits, interrupts must be off*/
+static uint32_t extend_time(uint16_t ticks)
 {
-	TCCR3B &= ~((1 << CS32) | (1 << CS31) | (1 << CS30));
+	uint16_t hi = time_hi;
+
+	/*Overflow not yet serviced by the interrupt*/
+	if((TIFR3 & (1 << TOV3)) && (ticks < 0x8000)) hi++;
+
+	return ((uint32_t)hi << 16) | ticks;
 }
 
-/*Determines whether or not a rising edge has occurred*/
-static bool detect_rising_edge(void)
+/*Stores the result of the ping in progress*/
+static void publish(sensor id, uint16_t width)
 {
-	if(curr_sensor_id == A) 
-	{	
-		/*Return reading on sensor A echo pin*/
-		return (PIN(ECHO_A_PORT) & (1 << ECHO_A_POS));
-	}
-	/*Return reading on sensor B echo pin*/
-	return (PIN(ECHO_B_PORT) & (1 << ECHO_B_POS));	
+	readings[id].width = width;
+	readings[id].time = ping_time;
+	readings[id].count++;
+	filter_pending |= (1 << id);
 }
 
-/*Converts time in microseconds to distance in centimeters*/
-static accum us_to_cm(uint16_t time)
+/*Converts time in microseconds to distance in millimetres*/
+static uint16_t us_to_mm(uint16_t time)
 {
-	return (SPEED_SOUND * (accum)time);
+	return (uint16_t)(((uint32_t)time * sound_q16 + 0x8000UL) >> 16);
+}
+
+/*Filters the readings just published, must be the last thing an
+  ISR does as it enables interrupts*/
+static void filter_reading(void)
+{
+	/*Claimed before interrupts are enabled, so a nested ISR only
+	  sees readings published after this point*/
+	uint8_t pending = filter_pending;
+	filter_pending = 0;
+
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
+	{
+		if(!(pending & (1 << id))) continue;
+
+		uint16_t width = readings[id].width;
+
+		sei();
+		update_range_filter(&filters[id], width ? us_to_mm(width) : 0);
+		uint16_t ground = get_range_median(&filters[id]);
+		uint8_t confidence = get_range_confidence(&filters[id]);
+		cli();
+
+		readings[id].ground = ground;
+		readings[id].confidence = confidence;
+	}
 }
 
 /********************************************
  * 	     Interrupt Service Routines         *
  ********************************************/
-/*Determines the width of returned pulse*/
-ISR(PCINT0_vect)
-{	
-	/*Rising edge pin change*/
-	if(detect_rising_edge())
+/*Starts the next slot of the schedule*/
+ISR(TIMER3_COMPA_vect)
+{
+	uint16_t now = TCNT3;
+
+	/*Echoes of the last slot that never ended*/
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
 	{
-		TCNT3 = 0;
-		start_counter();
-		echo = false;
+		if((active & (1 << id)) && !echoes[id].done)
+		{
+			publish(id, 0);
+			echoes[id].done = true;
+		}
 	}
-	/*Falling edge pin change*/
-	else
+
+	/*Next group of sensors that cannot hear each other*/
+	if(++curr_slot >= num_slots) curr_slot = 0;
+	active = slots[curr_slot];
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
 	{
-		stop_counter();
-		//Count only one direction
-		pulse_width = TCNT3 >> 1;
-		echo = true;
+		if(!(active & (1 << id))) continue;
+		echoes[id].started = false;
+		echoes[id].done = false;
+	}
+	select_echoes(active);
+
+	/*Trigger pulses, ended by compare match B*/
+	set_triggers(active);
+	ping_time = extend_time(now);
+	OCR3B = now + TRIGGER_TICKS;
+	TIFR3 = (1 << OCF3B);
+	TIMSK3 |= (1 << OCIE3B);
+
+	OCR3A += slot_period;
+
+	/*Filter the timeouts*/
+	filter_reading();
+}
+
+/*Ends the trigger pulses*/
+ISR(TIMER3_COMPB_vect)
+{
+	clear_triggers(active);
+	TIMSK3 &= ~(1 << OCIE3B);
+}
+
+#ifdef US_INPUT_CAPTURE
+/*Hardware timestamp of an edge of the returned pulse*/
+ISR(TIMER3_CAPT_vect)
+{
+	bool rising = (TCCR3B & (1 << ICES3));
+	uint32_t stamp = extend_time(ICR3);
+
+	/*A slot holds a single sensor*/
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
+	{
+		if(active & (1 << id)) echo_edge(id, rising, stamp);
 	}
+
+	/*Capture the falling edge next*/
+	TCCR3B &= ~(1 << ICES3);
+	TIFR3 = (1 << ICF3);
+
+	filter_reading();
 }
+#else
+/*Timestamps the edges of the returned pulses*/
+ISR(PCINT0_vect)
+{
+	uint32_t stamp = extend_time(TCNT3);
+	uint8_t level = PIN(US_ECHO_PORT);
+	uint8_t changed = level ^ last_echo;
+
+	last_echo = level;
 
-/*Sensor time-out functionality*/
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
+	{
+		if((active & (1 << id)) && (changed & pins[id].echo))
+		{
+			echo_edge(id, level & pins[id].echo, stamp);
+		}
+	}
+
+	filter_reading();
+}
+#endif
+
+/*Extends Timer3 to 32 bits*/
 ISR(TIMER3_OVF_vect)
 {
-	timeout = true;
+	time_hi++;
 }
 
 /********************************************
@@ -200,61 +537,190 @@ ISR(TIMER3_OVF_vect)
 void init_ultrasonic_sensors(void)
 {
 	sei();
+#ifdef US_INPUT_CAPTURE
+	/*Filter noise on the shared echo input ICP3*/
+	TCCR3B |= (1 << ICNC3);
+#else
 	/*Enable pin change interrupts 7:0*/
 	PCICR |= (1 << PCIE0);
+#endif
 	/*Enable timer overflow interrupts*/
+	TIFR3 = (1 << TOV3);
 	TIMSK3 |= (1 << TOIE3);
 	/*Configure timer/counter3 to normal mode*/
 	TCCR3A &= ~((1 << WGM31) | (1 << WGM30));
 	TCCR3B &= ~((1 << WGM33) | (1 << WGM32));
-	/*Configure sensor1 ports*/
-	DDR(TRIGGER_A_PORT) |= (1 << TRIGGER_A_POS);
-	DDR(ECHO_A_PORT) &= ~(1 << ECHO_A_POS);
-	/*Configure sensor2 ports*/
-	DDR(TRIGGER_B_PORT) |= (1 << TRIGGER_B_POS);
-	DDR(ECHO_B_PORT) &= ~(1 << ECHO_B_POS);
+	/*Runs continuously as the ranging time base*/
+	start_counter();
+	/*Configure the sensor ports and ground distance filters*/
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
+	{
+		*pins[id].ddr |= pins[id].trigger;
+		DDR(US_ECHO_PORT) &= ~pins[id].echo;
+		echoes[id].done = true;
+		init_range_filter(&filters[id], US_MEDIAN_LEN, US_GATE_MM);
+	}
+	clear_triggers(ALL_SENSORS);
+	build_schedule();
 }
 
 /*See ultrasonic.h for details*/
-accum get_obstacle_distance_cm(sensor id)
+void start_ultrasonic_ranging(void)
 {
-	/*Clear pulse width between calls*/
-	pulse_width = 0;
-	/*Reset echo flag between calls*/
-	echo = false;
-	/*Ensures only one sensor can generate interrupt*/
-	PCMSK0 &= CLEAR;
-	
-	/*Sensor A will be used*/
-	if(id == A) 
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		curr_sensor_id = A;
-		PCMSK0 |= (1 << PCINT1);
-		pulse_trigger_a();
+		/*First ping one period from now, in the first slot*/
+		OCR3A = TCNT3 + slot_period;
+		curr_slot = num_slots - 1;
+		active = 0;
+		/*Readings from before a stop are stale*/
+		for(uint8_t id = 0; id < NUM_SENSORS; id++)
+		{
+			reset_range_filter(&filters[id]);
+			readings[id].ground = 0;
+			readings[id].confidence = 0;
+		}
+		TIFR3 = (1 << OCF3A);
+		TIMSK3 |= (1 << OCIE3A);
+		ranging = true;
 	}
-	/*Sensor B will be used*/
-	else 
+}
+
+/*See ultrasonic.h for details*/
+void stop_ultrasonic_ranging(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		curr_sensor_id = B;
-		PCMSK0 |= (1 << PCINT3);
-		pulse_trigger_b();
+		TIMSK3 &= ~((1 << OCIE3A) | (1 << OCIE3B) | (1 << ICIE3));
+		PCMSK0 &= CLEAR;
+		clear_triggers(ALL_SENSORS);
+		active = 0;
+		ranging = false;
 	}
-	
-	/*Poll the echo flag*/
-	while(!echo)
+}
+
+/*See ultrasonic.h for details*/
+void set_ultrasonic_crosstalk(sensor id, uint8_t heard)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		//exit if timeout occurs
-		if(timeout) 
+		hears[id] = heard;
+		for(uint8_t other = 0; other < NUM_SENSORS; other++)
 		{
-			timeout = false;
-			return ULTRASONIC_TIMEOUT;
+			if(other == id) continue;
+			if(heard & (1 << other)) hears[other] |= (1 << id);
+			else hears[other] &= ~(1 << id);
 		}
+		/*The new schedule starts from its first slot*/
+		build_schedule();
+		curr_slot = num_slots - 1;
 	}
-	
-	/*Disable sensors when not in use*/
-	PCMSK0 &= CLEAR;
-	
+}
+
+/*See ultrasonic.h for details*/
+uint8_t get_ultrasonic_slots(void)
+{
+	return num_slots;
+}
+
+/*See ultrasonic.h for details*/
+uint16_t get_ultrasonic_period(void)
+{
+	return slot_period;
+}
+
+/*See ultrasonic.h for details*/
+void set_ultrasonic_temp(int8_t temp)
+{
+	if(temp < TEMP_MIN) temp = TEMP_MIN;
+	if(temp > TEMP_MAX) temp = TEMP_MAX;
+
+	uint16_t q16 = SOUND_Q16(SOUND_MM_S_0C + SOUND_MM_S_PER_C * temp);
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		sound_q16 = q16;
+	}
+}
+
+/*See ultrasonic.h for details*/
+uint16_t get_range_mm(sensor id)
+{
+	uint16_t width;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		width = readings[id].width;
+	}
+
+	if(width == 0) return ULTRASONIC_TIMEOUT;
+
+	return us_to_mm(width);
+}
+
+/*See ultrasonic.h for details*/
+uint16_t get_ground_mm(sensor id)
+{
+	uint16_t ground;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		ground = readings[id].ground;
+	}
+
+	if(ground == 0) return ULTRASONIC_TIMEOUT;
+
+	return ground;
+}
+
+/*See ultrasonic.h for details*/
+uint8_t get_ground_confidence(sensor id)
+{
+	return readings[id].confidence;
+}
+
+/*See ultrasonic.h for details*/
+uint32_t get_range_time(sensor id)
+{
+	uint32_t time;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		time = readings[id].time;
+	}
+
+	return time;
+}
+
+/*See ultrasonic.h for details*/
+uint8_t get_range_count(sensor id)
+{
+	return readings[id].count;
+}
+
+/*See ultrasonic.h for details*/
+uint32_t get_ultrasonic_time(void)
+{
+	uint32_t now;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		now = extend_time(TCNT3);
+	}
+
+	return now;
+}
+
+/*See ultrasonic.h for details*/
+accum get_obstacle_distance_cm(sensor id)
+{
+	if(!ranging) start_ultrasonic_ranging();
+
+	/*Wait for the next reading of the sensor*/
+	uint8_t count = readings[id].count;
+	while(readings[id].count == count);
+
 	/*Return the obstacle distince in cm*/
-	return us_to_cm(pulse_width);
+	return (accum)get_range_mm(id) / 10;
 }
 /* End of ultrasonic.c */
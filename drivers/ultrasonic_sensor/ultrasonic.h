@@ -5,8 +5,27 @@
  *  - Driver that enables reading of an ultrasonic ping sensor
  *    such as those made by Polulu or Parallax. The driver utilizes
  *    the pin change interrupt functionality of an AVR micrcontroller
- *    to determine distance of an obstacle. Timer overflow interrupts
- *    are used to provide a timeout feature to the software. 
+ *    to determine distance of an obstacle. Up to US_MAX_SENSORS
+ *    sensors are pinged in the background from Timer/Counter3 and
+ *    the latest distance and time of each sensor can be read at
+ *    any time without waiting. An echo that does not end before
+ *    the next ping is reported as a timeout.
+ *
+ *    Sensors that cannot hear each other's pings, for example ones
+ *    facing away from each other around the landing gear, are
+ *    pinged together. The US_HEARS_x masks give the sensors each
+ *    sensor can hear. By default A and B hear each other and are
+ *    pinged alternately.
+ *
+ *    Ranges are integer millimetres corrected for the speed of
+ *    sound at the air temperature given by set_ultrasonic_temp(),
+ *    for example from the gyroscope die temperature. Define
+ *    US_INPUT_CAPTURE to time the echoes with the Timer3 input
+ *    capture unit. The echo outputs of all sensors must then be
+ *    combined onto ICP3 (PB5) and only one sensor is pinged at a
+ *    time. The slots are then longer than the 38ms echo of a sensor
+ *    that heard nothing, which would otherwise hide the echo of the
+ *    next sensor. PB5 is also used by the LCD and the ISP programmer.
  *
  **************************************************************/
  
@@ -17,30 +36,69 @@
  * 		          Includes                  *
  ********************************************/ 
 #include <stdfix.h>
+#include <stdint.h>
 
 /********************************************
  * 		           Macros                   *
  ********************************************/
+/*Echo Port of All Sensors, Must Be Port A (PCINT7:0)*/
+#define US_ECHO_PORT A
+
 /*Ultrasonic Sensor A Port Definitions*/
 #define TRIGGER_A_PORT A
-#define ECHO_A_PORT    A
 #define TRIGGER_A_POS  0
 #define ECHO_A_POS     1
 
 /*Ultrasonic Sensor B Port Defintions*/
 #define TRIGGER_B_PORT A
-#define ECHO_B_PORT    A
 #define TRIGGER_B_POS  2 
 #define ECHO_B_POS     3
 
+/*Sensors C and D need TRIGGER_x_PORT, TRIGGER_x_POS and ECHO_x_POS
+  definitions like A and B, here or on the command line along with
+  NUM_SENSORS. Port A has no free pins on this board.*/
+
 /*Ultrasonic Sensor Error Code*/
 #define ULTRASONIC_TIMEOUT 0
 
+/*Number of Sensors*/
+#ifndef NUM_SENSORS
+#define NUM_SENSORS    2
+#endif
+#define US_MAX_SENSORS 4
+
+/*Sensors Each Sensor Can Hear, Bit n is Sensor n*/
+#define US_HEARS_A (1 << B)
+#define US_HEARS_B (1 << A)
+#define US_HEARS_C 0
+#define US_HEARS_D 0
+
+/*Time Between Slots in us, Each Sensor is Read Once per Schedule.
+  With input capture a slot outlasts the sensor's own 38ms timeout.*/
+#ifdef US_INPUT_CAPTURE
+#define US_PING_PERIOD 40000U
+#else
+#define US_PING_PERIOD 30000U
+#endif
+
+/*Shortest Time Between Pings of a Sensor in us. A sensor that heard
+  nothing holds its echo for 38ms, so a schedule with too few slots
+  has them stretched to keep each sensor from being pinged again
+  before its last echo has ended.*/
+#define US_REVISIT_MIN 40000U
+
+/*Air Temperature Assumed Until set_ultrasonic_temp() is Called (C)*/
+#define US_DEFAULT_TEMP 20
+
+/*Ground Filter Median Length and Largest Step Between Readings (mm)*/
+#define US_MEDIAN_LEN 5
+#define US_GATE_MM    50
+
 /********************************************
  * 		         Typedefs                   *
  ********************************************/
 /*Sensor Identifiers*/
-typedef enum {A,B} sensor;
+typedef enum {A,B,C,D} sensor;
 
 /********************************************
  * 		      Function Prototypes           *
@@ -49,22 +107,140 @@ typedef enum {A,B} sensor;
 /***************************************************************
  *
  * DESCRIPTION:
- *  - Performs necessary setup for ultrasonic sensors A and B.
+ *  - Performs necessary setup for the ultrasonic sensors.
  *    Enables global and pin-change interrupt functionality and
  *    configures the trigger and echo input/output ports.
  *    Additionally, it enables timer overflow interrupts (TOV)
- *    to be used for the sensor timeout feature.
+ *    to be used for the sensor timeout feature, and builds the
+ *    ping schedule from the US_HEARS_x masks.
  *
  **************************************************************/
 void init_ultrasonic_sensors(void);
 
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Starts pinging the sensors in the background, one slot of
+ *    the schedule every get_ultrasonic_period(). The first ping is
+ *    sent one period after the call.
+ *
+ **************************************************************/
+void start_ultrasonic_ranging(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Stops background ranging. The last readings are kept.
+ *
+ **************************************************************/
+void stop_ultrasonic_ranging(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Sets the sensors that sensor "id" can hear (bit n is sensor
+ *    n) and rebuilds the schedule. Cross-talk goes both ways, so
+ *    the other sensors are updated to match. The new schedule
+ *    starts at the next slot.
+ *
+ **************************************************************/
+void set_ultrasonic_crosstalk(sensor id, uint8_t heard);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the number of slots in the schedule. Each sensor is
+ *    read once every slots * get_ultrasonic_period().
+ *
+ **************************************************************/
+uint8_t get_ultrasonic_slots(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the time between slots in us. This is US_PING_PERIOD
+ *    unless the schedule has so few slots that a sensor would be
+ *    pinged again within US_REVISIT_MIN, in which case the slots
+ *    are stretched to give each sensor US_REVISIT_MIN.
+ *
+ **************************************************************/
+uint16_t get_ultrasonic_period(void);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Sets the air temperature in degrees Celsius used to compute
+ *    the speed of sound. Limited to -40 to 85 degrees.
+ *
+ **************************************************************/
+void set_ultrasonic_temp(int8_t temp);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the latest distance measured by a sensor in
+ *    millimetres without waiting, or ULTRASONIC_TIMEOUT if the
+ *    last ping received no echo or the sensor has not been read.
+ *
+ **************************************************************/
+uint16_t get_range_mm(sensor id);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the filtered ground distance of a sensor in
+ *    millimetres without waiting: the median of the last
+ *    US_MEDIAN_LEN readings that passed the US_GATE_MM step gate.
+ *    Returns ULTRASONIC_TIMEOUT until a reading has been accepted.
+ *
+ **************************************************************/
+uint16_t get_ground_mm(sensor id);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the share of the last 8 readings of a sensor that
+ *    were accepted by the ground filter, 0 to 100 percent. Echo
+ *    timeouts and outliers lower the confidence.
+ *
+ **************************************************************/
+uint8_t get_ground_confidence(sensor id);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the time in microseconds at which the latest reading
+ *    of a sensor was pinged, on the get_ultrasonic_time() clock.
+ *
+ **************************************************************/
+uint32_t get_range_time(sensor id);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns a count of the readings of a sensor, which wraps
+ *    around. A change indicates a new reading.
+ *
+ **************************************************************/
+uint8_t get_range_count(sensor id);
+
+/***************************************************************
+ *
+ * DESCRIPTION:
+ *  - Returns the free running ranging time in microseconds.
+ *    Wraps around after about 71 minutes.
+ *
+ **************************************************************/
+uint32_t get_ultrasonic_time(void);
+
 /***************************************************************
  *
  * DESCRIPTION:
  *  - Returns the distance of an obstacle in centimeters. Includes
  *    timeout functionality if an obstacle cannot be detected. The
  *    user can select between reading sensor A and B by passing the
- *    sensor ID letter "A" or "B" to function. 
+ *    sensor ID letter "A" or "B" to function. Waits for the next
+ *    reading of the sensor, starting background ranging if needed.
  *
  **************************************************************/
 accum get_obstacle_distance_cm(sensor id);
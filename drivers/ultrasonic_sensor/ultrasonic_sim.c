@@ -0,0 +1,386 @@
+/***************************************************************
+ * Nicholas Shanahan (2016)
+ *
+ * DESCRIPTION:
+ *  - Host simulation of the background ranging of the ultrasonic
+ *    driver. Runs ultrasonic.c against the register stand-ins in
+ *    host_sim, with Timer3 counting simulated microseconds and its
+ *    compare, overflow and pin change vectors called as the timer
+ *    and pins change.
+ *
+ *    Each sensor raises its echo ECHO_DELAY_US after its trigger
+ *    rises and holds it for the width given by its script. A
+ *    script may instead return NO_ECHO, which holds the echo high
+ *    for the sensor's own 38ms timeout so the driver sees no end
+ *    within the slot.
+ *
+ *    A fixed echo is then ranged at several air temperatures. The
+ *    sim is also built with US_INPUT_CAPTURE, in which case the
+ *    echoes are combined onto the capture input as on the board and
+ *    the capture vector is called on the selected edge.
+ *
+ *    The ground filter is checked by comparing the median of the
+ *    range filter with a sorted copy of its window over random
+ *    readings, then shown rejecting spikes and timeouts and taking
+ *    a real step in the ground distance.
+ *
+ *    Sensors that cannot hear each other are then pinged together
+ *    with overlapping echoes. make sim also builds the sim with four
+ *    sensors, C and D on spare pins, to check the slots found for a
+ *    path, a triangle and a complete graph of cross-talk.
+ *
+ *      make sim
+ *
+ **************************************************************/
+
+#include "ultrasonic.h"
+#include "range_filter.h"
+#include <avr/io.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/*Concatenation Macros*/
+#define CONCAT(A,B) (A##B)
+#define PORT(letter) CONCAT(PORT,letter)
+
+/*Echo model*/
+#define ECHO_DELAY_US   200   //Trigger to echo rising edge
+#define ECHO_TIMEOUT_US 38000 //Echo length of a sensor that heard nothing
+#define NO_ECHO         0
+
+/*Readings compared with the sorted window per median size*/
+#define MEDIAN_CHECKS 20000
+
+/*Interrupt vectors of ultrasonic.c*/
+void TIMER3_COMPA_vect(void);
+void TIMER3_COMPB_vect(void);
+void TIMER3_OVF_vect(void);
+#ifdef US_INPUT_CAPTURE
+void TIMER3_CAPT_vect(void);
+#else
+void PCINT0_vect(void);
+#endif
+
+/*Timer3 Interrupt Mask Bits*/
+#define TOIE3  0
+#define OCIE3A 1
+#define OCIE3B 2
+#define ICIE3  5
+
+/*Timer3 Input Capture Edge Select*/
+#define ICES3 6
+
+/*Simulated sensor*/
+typedef struct {
+	volatile uint8_t *port; //Trigger output port
+	uint8_t trigger;        //Trigger pin mask
+	uint8_t echo;           //Echo pin mask on port A
+	bool triggered;         //Trigger level at the last step
+	uint16_t pings;         //Pings heard
+	uint32_t rise;          //Time the echo rises, 0 if none pending
+	uint32_t fall;          //Time the echo falls
+	uint16_t (*script)(uint16_t ping); //Echo width of each ping (us)
+}sim_sensor;
+
+static sim_sensor sensors[] = {
+	{&PORT(TRIGGER_A_PORT), (1 << TRIGGER_A_POS), (1 << ECHO_A_POS),
+	 false, 0, 0, 0, NULL},
+	{&PORT(TRIGGER_B_PORT), (1 << TRIGGER_B_POS), (1 << ECHO_B_POS),
+	 false, 0, 0, 0, NULL},
+#if NUM_SENSORS > 2
+	{&PORT(TRIGGER_C_PORT), (1 << TRIGGER_C_POS), (1 << ECHO_C_POS),
+	 false, 0, 0, 0, NULL},
+#endif
+#if NUM_SENSORS > 3
+	{&PORT(TRIGGER_D_PORT), (1 << TRIGGER_D_POS), (1 << ECHO_D_POS),
+	 false, 0, 0, 0, NULL},
+#endif
+};
+
+#define SIM_SENSORS (sizeof(sensors) / sizeof(sensors[0]))
+
+/*Simulated time (us)*/
+static uint32_t now = 0;
+
+/*Readings seen of each sensor*/
+static uint8_t seen[SIM_SENSORS];
+
+/*Advances Timer3 and the sensors by one microsecond*/
+static void step(void)
+{
+	uint8_t echo_level = PINA;
+
+	now++;
+	TCNT3 = (uint16_t)now;
+	if((TCNT3 == 0) && (TIMSK3 & (1 << TOIE3))) TIMER3_OVF_vect();
+	if((TIMSK3 & (1 << OCIE3A)) && (TCNT3 == OCR3A)) TIMER3_COMPA_vect();
+	if((TIMSK3 & (1 << OCIE3B)) && (TCNT3 == OCR3B)) TIMER3_COMPB_vect();
+
+	for(uint8_t id = 0; id < SIM_SENSORS; id++)
+	{
+		sim_sensor *s = &sensors[id];
+		bool triggered = (*s->port & s->trigger);
+
+		/*A ping starts on the rising edge of the trigger*/
+		if(triggered && !s->triggered && s->script)
+		{
+			uint16_t width = s->script(s->pings++);
+			s->rise = now + ECHO_DELAY_US;
+			s->fall = s->rise + ((width == NO_ECHO) ? ECHO_TIMEOUT_US : width);
+		}
+		s->triggered = triggered;
+
+		if(s->rise && (now == s->rise)) PINA |= s->echo;
+		if(s->rise && (now == s->fall))
+		{
+			PINA &= ~s->echo;
+			s->rise = 0;
+		}
+	}
+
+#ifdef US_INPUT_CAPTURE
+	/*Echo outputs are combined onto ICP3*/
+	uint8_t echoes = 0;
+	for(uint8_t id = 0; id < SIM_SENSORS; id++) echoes |= sensors[id].echo;
+
+	bool level = (PINA & echoes);
+	if((level != (bool)(echo_level & echoes)) && (TIMSK3 & (1 << ICIE3)) &&
+	   (level == (bool)(TCCR3B & (1 << ICES3))))
+	{
+		ICR3 = TCNT3;
+		TIMER3_CAPT_vect();
+	}
+#else
+	if((echo_level ^ PINA) & PCMSK0) PCINT0_vect();
+#endif
+	TIFR3 = 0;
+}
+
+/*Runs until "until" us, printing each new reading if "show"*/
+static void run(uint32_t until, bool show)
+{
+	while(now < until)
+	{
+		step();
+
+		for(uint8_t id = 0; id < SIM_SENSORS; id++)
+		{
+			if(get_range_count(id) == seen[id]) continue;
+			seen[id] = get_range_count(id);
+			if(!show) continue;
+
+			printf("  %7lu us: %c %4u mm, ground %4u mm (%3u%%), "
+			       "pinged at %7lu us\n",
+			       (unsigned long)now, 'A' + id, get_range_mm(id),
+			       get_ground_mm(id), get_ground_confidence(id),
+			       (unsigned long)get_range_time(id));
+		}
+	}
+}
+
+/*Sensor A sees the ground at a steady 2000us*/
+static uint16_t steady_ground(uint16_t ping)
+{
+	(void)ping;
+	return 2000;
+}
+
+/*Sensor B hears nothing on every third ping*/
+static uint16_t lossy_ground(uint16_t ping)
+{
+	return ((ping % 3) == 2) ? NO_ECHO : 1500;
+}
+
+/*Sensor A hears a spike on every fifth ping and nothing on every
+  seventh*/
+static uint16_t noisy_ground(uint16_t ping)
+{
+	if((ping % 7) == 6) return NO_ECHO;
+	return ((ping % 5) == 4) ? 3000 : 2000;
+}
+
+/*Sensor B sees the ground come 600us closer after its sixth ping*/
+static uint16_t stepped_ground(uint16_t ping)
+{
+	return (ping < 6) ? 2000 : 1400;
+}
+
+/*Alternating pings, distances, timestamps and timeouts*/
+static void run_background(void)
+{
+	printf("Background ranging, %u slots of %uus\n",
+	       get_ultrasonic_slots(), get_ultrasonic_period());
+	sensors[A].script = steady_ground;
+	sensors[B].script = lossy_ground;
+	start_ultrasonic_ranging();
+	run(now + 400000, true);
+	stop_ultrasonic_ranging();
+	printf("  stopped, triggers %s\n",
+	       (PORTA & (sensors[A].trigger | sensors[B].trigger)) ? "high" : "low");
+}
+
+/*Speed of sound at each air temperature*/
+static void run_temperature(void)
+{
+	static const int8_t temps[] = {-20, 0, 20, 40};
+
+	printf("Echo of 2000us by air temperature\n");
+	sensors[A].script = steady_ground;
+	sensors[B].script = steady_ground;
+	for(uint8_t i = 0; i < sizeof(temps); i++)
+	{
+		set_ultrasonic_temp(temps[i]);
+		start_ultrasonic_ranging();
+		run(now + 2UL * get_ultrasonic_period() * get_ultrasonic_slots(), false);
+		stop_ultrasonic_ranging();
+
+		/*Half the round trip at 331.3 m/s + 0.606 m/s per degree*/
+		printf("  %3d C: A %3u mm, B %3u mm, expected %5.1f mm\n",
+		       temps[i], get_range_mm(A), get_range_mm(B),
+		       (331.3 + 0.606 * temps[i]) * 2000 / 2 / 1000);
+	}
+	set_ultrasonic_temp(US_DEFAULT_TEMP);
+}
+
+/*A and B cannot hear each other and share a slot*/
+static void run_overlap(void)
+{
+	set_ultrasonic_crosstalk(A, 0);
+	printf("A and B apart, %u slots of %uus\n", get_ultrasonic_slots(),
+	       get_ultrasonic_period());
+	sensors[A].script = steady_ground;
+	sensors[B].script = lossy_ground;
+	start_ultrasonic_ranging();
+	run(now + 6UL * get_ultrasonic_period(), true);
+	stop_ultrasonic_ranging();
+	set_ultrasonic_crosstalk(A, US_HEARS_A);
+}
+
+#if NUM_SENSORS > 3
+/*Slots for a cross-talk graph, and pairs that hear each other but
+  were pinged in the same slot*/
+static void run_graph(const char *name, const uint8_t *heard)
+{
+	uint8_t conflicts = 0;
+
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
+	{
+		set_ultrasonic_crosstalk(id, heard[id]);
+		sensors[id].script = steady_ground;
+	}
+	start_ultrasonic_ranging();
+	run(now + (get_ultrasonic_slots() + 1UL) * get_ultrasonic_period(), false);
+	stop_ultrasonic_ranging();
+
+	for(uint8_t id = 0; id < NUM_SENSORS; id++)
+	{
+		for(uint8_t other = id + 1; other < NUM_SENSORS; other++)
+		{
+			if((heard[id] & (1 << other)) &&
+			   (get_range_time(id) == get_range_time(other))) conflicts++;
+		}
+	}
+	printf("  %-8s: %u slots, %u conflicts, pinged at %lu %lu %lu %lu us\n",
+	       name, get_ultrasonic_slots(), conflicts,
+	       (unsigned long)get_range_time(A), (unsigned long)get_range_time(B),
+	       (unsigned long)get_range_time(C), (unsigned long)get_range_time(D));
+}
+
+/*Path A-B-C-D, triangle A-B-C with D apart, and every pair*/
+static void run_graphs(void)
+{
+	static const uint8_t path[] = {
+		(1 << B), (1 << A) | (1 << C), (1 << B) | (1 << D), (1 << C)};
+	static const uint8_t triangle[] = {
+		(1 << B) | (1 << C), (1 << A) | (1 << C), (1 << A) | (1 << B), 0};
+	static const uint8_t complete[] = {0x0E, 0x0D, 0x0B, 0x07};
+
+	printf("Cross-talk graphs of four sensors\n");
+	run_graph("path", path);
+	run_graph("triangle", triangle);
+	run_graph("complete", complete);
+}
+#endif
+
+/*Orders two readings for qsort()*/
+static int compare(const void *a, const void *b)
+{
+	return *(const uint16_t *)a - *(const uint16_t *)b;
+}
+
+/*Median of the range filter against a sorted copy of its window*/
+static void run_median_check(void)
+{
+	printf("Median against the sorted window\n");
+	srand(1);
+	for(uint8_t size = 1; size <= RANGE_MEDIAN_MAX; size += 2)
+	{
+		range_filter filt;
+		uint16_t window[RANGE_MEDIAN_MAX];
+		uint16_t sorted[RANGE_MEDIAN_MAX];
+		uint8_t count = 0, next = 0;
+		uint16_t errors = 0;
+
+		init_range_filter(&filt, size, 0);
+		for(uint16_t i = 0; i < MEDIAN_CHECKS; i++)
+		{
+			/*Start over now and then, with dropouts and repeats*/
+			if((rand() % 500) == 0)
+			{
+				reset_range_filter(&filt);
+				count = next = 0;
+			}
+			uint16_t range = (rand() % 10) ? 1 + (rand() % 40) * 25 : 0;
+
+			update_range_filter(&filt, range);
+			if(range == 0) continue;
+
+			window[next] = range;
+			if(++next == size) next = 0;
+			if(count < size) count++;
+
+			/*Upper median while the window is filling*/
+			for(uint8_t k = 0; k < count; k++) sorted[k] = window[k];
+			qsort(sorted, count, sizeof(sorted[0]), compare);
+			if(get_range_median(&filt) != sorted[count / 2]) errors++;
+		}
+		printf("  size %u: %u readings, %u mismatches\n",
+		       size, MEDIAN_CHECKS, errors);
+	}
+}
+
+/*Spikes and timeouts are rejected, a real step is taken*/
+static void run_outliers(void)
+{
+	printf("Spikes, timeouts and a step in the ground\n");
+	sensors[A].script = noisy_ground;
+	sensors[B].script = stepped_ground;
+	sensors[A].pings = 0;
+	sensors[B].pings = 0;
+	start_ultrasonic_ranging();
+	run(now + 16UL * get_ultrasonic_period() * get_ultrasonic_slots(), true);
+	stop_ultrasonic_ranging();
+}
+
+int main(void)
+{
+	init_ultrasonic_sensors();
+	TIFR3 = 0;
+
+#ifdef US_INPUT_CAPTURE
+	printf("Input capture build\n");
+#endif
+	run_background();
+	run_temperature();
+	run_median_check();
+	run_outliers();
+	run_overlap();
+#if NUM_SENSORS > 3
+	run_graphs();
+#endif
+
+	return 0;
+}
+/* End of ultrasonic_sim.c */